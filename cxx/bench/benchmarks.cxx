@@ -0,0 +1,271 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+
+#include <utils/bench.h>
+#include <utils/sparse.h>
+#include <utils/text.h>
+#include <vhash/index.h>
+#include <vhash/pipeline.h>
+#include <vhash/vhash.h>
+
+using namespace utils;
+using namespace vhash;
+
+
+/* Benchmarks of text processing, vectorization, fitting and transforming
+
+Usage: bin/bench.exe [--option=value ...] (or `make bench ARGS="..."`), with
+options (and defaults):
+
+    --docs=20000           number of synthetic documents
+    --vocab=50000          number of distinct words
+    --length=100           mean number of words per document
+    --classes=4            number of classes
+    --zipf=1               Zipf exponent of word frequencies
+    --seed=0               random seed for the corpus
+    --min_time=0.5         minimum time to run each benchmark for (seconds)
+    --ngram=3              largest_ngram of the model
+    --features=1000        num_features of the model
+    --intern_words=0       intern_words of the model
+    --n_jobs=1             n_jobs of the model
+    --memory_budget=0      memory_budget of the model (bytes)
+    --quantize=none        quantize of the model (none, fp16 or int8)
+    --max_feature_terms=0  max_feature_terms of the model
+    --feature_mass=1       feature_mass of the model
+    --filter=              only run benchmarks whose names contain this
+ */
+class vhash::Bench {
+    public:
+
+        // names of options
+        static const vector <string> option_names;
+
+        // run benchmarks
+        static void run(const std::map <string, string>& options);
+
+    private:
+
+        // get option, or its default
+        static double _option(
+            const std::map <string, string>& options,
+            const string& name,
+            const double& fallback
+        );
+};
+
+const vector <string> vhash::Bench::option_names = {
+    "docs", "vocab", "length", "classes", "zipf", "seed", "min_time",
+    "ngram", "features", "intern_words", "n_jobs", "memory_budget", "quantize",
+    "max_feature_terms", "feature_mass", "filter",
+};
+
+double vhash::Bench::_option(
+    const std::map <string, string>& options,
+    const string& name,
+    const double& fallback
+) {
+    auto found = options.find(name);
+    return found == options.end()? fallback: std::stod(found->second);
+}
+
+void vhash::Bench::run(const std::map <string, string>& options) {
+
+    // generate corpus
+    size_t num_docs = _option(options, "docs", 20000);
+    size_t num_classes = _option(options, "classes", 4);
+    auto [docs, labels] = bench::zipf_corpus(
+        num_docs,
+        _option(options, "vocab", 50000),
+        _option(options, "length", 100),
+        num_classes,
+        _option(options, "zipf", 1),
+        _option(options, "seed", 0)
+    );
+    size_t num_bytes = 0;
+    for (const string& doc: docs) {
+        num_bytes += doc.size();
+    }
+    printf("corpus: %zu docs, %.1f MB, %zu classes\n\n", docs.size(), num_bytes / 1E6, num_classes);
+
+    // set up model
+    double min_time = _option(options, "min_time", 0.5);
+    VHash params = VHash(
+        _option(options, "ngram", 3),
+        1E-3,
+        _option(options, "features", 1000),
+        1E6,
+        100E3,
+        10E3,
+        1,
+        _option(options, "intern_words", 0),
+        _option(options, "n_jobs", 1),
+        _option(options, "memory_budget", 0),
+        options.count("quantize")? options.at("quantize"): "none",
+        _option(options, "max_feature_terms", 0),
+        _option(options, "feature_mass", 1)
+    );
+    auto filter = options.find("filter");
+    auto selected = [&](const string& name) {
+        return filter == options.end() || name.find(filter->second) != string::npos;
+    };
+    bench::report_header();
+
+    // format text (with the best kernel, then with each supported kernel)
+    if (selected("text::format")) {
+        string formatted;
+        bench::report("text::format", docs.size(), docs.size(), num_bytes, bench::time([&]() {
+            for (const string& doc: docs) {
+                text::format(doc, formatted);
+            }
+        }, min_time));
+        vector <std::pair <string, text::Simd>> kernels = {
+            {"none", text::Simd::none}, {"sse42", text::Simd::sse42}, {"avx2", text::Simd::avx2},
+        };
+        for (const auto& [name, simd]: kernels) {
+            if (simd > text::simd_support()) {continue;}
+            bench::report("text::format(" + name + ")", docs.size(), docs.size(), num_bytes, bench::time([&]() {
+                for (const string& doc: docs) {
+                    text::format(doc, formatted, simd);
+                }
+            }, min_time));
+        }
+    }
+
+    // split text into phrases (of every length the model uses)
+    if (selected("text::get_phrases")) {
+        size_t num_phrases = 0;
+        bench::report("text::get_phrases", docs.size(), docs.size(), num_bytes, bench::time([&]() {
+            for (const string& doc: docs) {
+                for (size_t len = params._smallest_ngram; len <= params._largest_ngram; len++) {
+                    num_phrases += text::get_phrases(doc, len).size();
+                }
+            }
+        }, min_time));
+    }
+    if (selected("text::Phrases")) {
+        text::Phrases phrases(params._smallest_ngram, params._largest_ngram);
+        size_t num_phrases = 0;
+        bench::report("text::Phrases", docs.size(), docs.size(), num_bytes, bench::time([&]() {
+            for (const string& doc: docs) {
+                phrases.parse(doc);
+                num_phrases += phrases.num_phrases();
+            }
+        }, min_time));
+    }
+
+    // fit (on a fresh copy of the model each time)
+    VHash fitted = params;
+    if (selected("VHash::fit")) {
+        bench::report("VHash::fit", docs.size(), docs.size(), num_bytes, bench::time([&]() {
+            fitted = params;
+            fitted.fit(docs, labels);
+        }, min_time));
+    } else {
+        fitted.fit(docs, labels);
+    }
+
+    // vectorize docs
+    vector <Sparse> vectorized(docs.size());
+    if (selected("VHash::_vectorize")) {
+        VHash::Tokenizer tokenizer(fitted);
+        bench::report("VHash::_vectorize", docs.size(), docs.size(), num_bytes, bench::time([&]() {
+            for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+                vectorized[doc_num] = fitted._vectorize(docs[doc_num], tokenizer);
+            }
+        }, min_time));
+    } else {
+        for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+            vectorized[doc_num] = fitted._vectorize(docs[doc_num]);
+        }
+    }
+
+    // dot products of consecutive docs
+    if (selected("Sparse::dot_product")) {
+        float total = 0;
+        bench::report("Sparse::dot_product", docs.size(), 0, 0, bench::time([&]() {
+            for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+                total += vectorized[doc_num].dot_product(vectorized[(doc_num + 1) % docs.size()]);
+            }
+        }, min_time));
+    }
+
+    // transform, into a preallocated buffer
+    if (selected("VHash::transform")) {
+        vector <float> out(docs.size() * fitted.num_features());
+        bench::report("VHash::transform", docs.size(), docs.size(), num_bytes, bench::time([&]() {
+            fitted.transform(docs, out.data(), fitted.num_features());
+        }, min_time));
+    }
+
+    // weighted phrase vectors, as CSR (without projecting onto features)
+    if (selected("VHash::transform_sparse")) {
+        vector <float> data;
+        vector <int32_t> indices;
+        vector <int64_t> indptr;
+        bench::report("VHash::transform_sparse", docs.size(), docs.size(), num_bytes, bench::time([&]() {
+            fitted.transform_sparse(docs, data, indices, indptr);
+        }, min_time));
+    }
+
+    // transform, in a pipeline of tokenize / lookup / project threads (then
+    // show how busy each stage was, to find the one that saturates)
+    if (selected("VHashPipeline::transform")) {
+        VHashPipeline pipeline(fitted);
+        vector <float> out(docs.size() * fitted.num_features());
+        bench::report("VHashPipeline::transform", docs.size(), docs.size(), num_bytes, bench::time([&]() {
+            pipeline.transform(docs, out.data(), fitted.num_features());
+        }, min_time));
+        for (const VHashPipeline::StageStats& stage: pipeline.stage_stats()) {
+            printf(
+                "    %-10s busy %5.1f%%, queue depth %.2f (max %zu)\n",
+                stage.name.c_str(),
+                100 * stage.utilization,
+                stage.mean_queue_depth,
+                stage.max_queue_depth
+            );
+        }
+    }
+
+    // top-10 search of the corpus for its first 100 docs (exactly, then
+    // probing 8 of ~sqrt(docs) lists)
+    if (selected("VHashIndex::query")) {
+        VHashIndex index(fitted, "none", _option(options, "n_jobs", 1));
+        index.add(docs);
+        size_t num_queries = std::min((size_t)100, docs.size()), k = 10;
+        vector <string> queries(docs.begin(), docs.begin() + num_queries);
+        bench::report("VHashIndex::query", num_queries, num_queries, 0, bench::time([&]() {
+            index.query(queries, k);
+        }, min_time));
+        index.build(std::sqrt(docs.size()));
+        bench::report("VHashIndex::query(ivf)", num_queries, num_queries, 0, bench::time([&]() {
+            index.query(queries, k, 8);
+        }, min_time));
+    }
+}
+
+int main(int argc, char** argv) {
+
+    // parse --option=value arguments
+    std::map <string, string> options;
+    for (int arg = 1; arg < argc; arg++) {
+        string option = argv[arg];
+        size_t equals = option.find('=');
+        if (option.compare(0, 2, "--") || equals == string::npos) {
+            fprintf(stderr, "Expected --option=value, got: %s\n", argv[arg]);
+            return EXIT_FAILURE;
+        }
+        string name = option.substr(2, equals - 2);
+        if (std::find(Bench::option_names.begin(), Bench::option_names.end(), name) == Bench::option_names.end()) {
+            fprintf(stderr, "Unknown option: --%s\n", name.c_str());
+            return EXIT_FAILURE;
+        }
+        options[name] = option.substr(equals + 1);
+    }
+
+    // run
+    Bench::run(options);
+}
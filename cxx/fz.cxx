@@ -0,0 +1,20 @@
+#include <cstdio>
+#include <random>
+#include <utils/text.h>
+#include "old.cxx"
+using namespace utils;
+int main(){
+  std::mt19937 rng(1);
+  const char alpha[] = "aZ09 .,-_\t\n@[`{/:\x80\xff";
+  for (int it=0; it<200000; it++){
+    size_t n = rng()% (it%100==0? 5000: 80);
+    string s(n,' ');
+    for(auto&c:s){ c = (rng()%4==0)? (char)(rng()%256) : alpha[rng()%(sizeof(alpha)-1)]; }
+    string expect = old_format(s);
+    for (auto simd: {text::Simd::none, text::Simd::sse42, text::Simd::avx2}) {
+      string out; text::format(s, out, simd);
+      if (out != expect) { printf("MISMATCH simd=%d n=%zu\n[%s]\n[%s]\n", (int)simd, n, out.c_str(), expect.c_str()); return 1; }
+    }
+  }
+  printf("ok simd=%d\n", (int)text::simd_support());
+}
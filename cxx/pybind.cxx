@@ -1,13 +1,18 @@
 #define __PYBIND_MODULE__
 
+#include <string>
 #include <vector>
 
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
+#include <vhash/index.h>
+#include <vhash/pipeline.h>
 #include <vhash/vhash.h>
 
 namespace py = pybind11;
+using std::string;
 using std::vector;
 
 
@@ -22,7 +27,13 @@ PYBIND11_MODULE(_vhash, m) {
                 const size_t&,
                 const size_t&,
                 const size_t&,
-                const size_t&
+                const size_t&,
+                const bool&,
+                const int&,
+                const size_t&,
+                const string&,
+                const size_t&,
+                const float&
             >(),
             py::arg("largest_ngram") = (size_t)3,
             py::arg("min_phrase_occurrence") = (float)1E-3,
@@ -30,29 +41,191 @@ PYBIND11_MODULE(_vhash, m) {
             py::arg("max_num_phrases") = (size_t)1E6,
             py::arg("downsample_to") = (size_t)100E3,
             py::arg("live_evaluation_step") = (size_t)10E3,
-            py::arg("smallest_ngram") = (size_t)1
+            py::arg("smallest_ngram") = (size_t)1,
+            py::arg("intern_words") = false,
+            py::arg("n_jobs") = 1,
+            py::arg("memory_budget") = (size_t)0,
+            py::arg("quantize") = "none",
+            py::arg("max_feature_terms") = (size_t)0,
+            py::arg("feature_mass") = (float)1
         )
         .def(
             "fit",
             &vhash::VHash::fit,
             py::arg("docs"),
-            py::arg("labels")
+            py::arg("labels"),
+            py::call_guard <py::gil_scoped_release>()
+        )
+        .def(
+            "partial_fit",
+            &vhash::VHash::partial_fit,
+            py::arg("docs"),
+            py::arg("labels"),
+            py::call_guard <py::gil_scoped_release>()
+        )
+        .def(
+            "finalize",
+            &vhash::VHash::finalize,
+            py::call_guard <py::gil_scoped_release>()
         )
         .def(
             "fit_transform",
-            &vhash::VHash::fit_transform,
+            &vhash::VHash::fit_transform_numpy,
             py::arg("docs"),
             py::arg("labels")
         )
         .def(
             "transform",
-            &vhash::VHash::transform,
+            &vhash::VHash::transform_numpy,
+            py::arg("docs"),
+            py::arg("out") = py::none(),
+            py::arg("dtype") = "float32"
+        )
+        .def(
+            "transform_sparse",
+            &vhash::VHash::transform_sparse_numpy,
             py::arg("docs")
         )
+        .def(
+            "num_phrases",
+            &vhash::VHash::num_phrases
+        )
+        .def(
+            "fit_file",
+            &vhash::VHash::fit_file,
+            py::arg("path"),
+            py::arg("labels_path") = "",
+            py::call_guard <py::gil_scoped_release>()
+        )
+        .def(
+            "transform_file",
+            &vhash::VHash::transform_file,
+            py::arg("path"),
+            py::arg("out_path"),
+            py::call_guard <py::gil_scoped_release>()
+        )
+        .def(
+            "memory_usage",
+            &vhash::VHash::memory_usage,
+            py::call_guard <py::gil_scoped_release>()
+        )
+        .def(
+            "feature_errors",
+            &vhash::VHash::feature_errors,
+            py::call_guard <py::gil_scoped_release>()
+        )
+        .def(
+            "stats",
+            &vhash::VHash::stats_dict
+        )
+        .def(
+            "reset_stats",
+            &vhash::VHash::reset_stats
+        )
+        .def(
+            "save",
+            &vhash::VHash::save,
+            py::arg("path"),
+            py::call_guard <py::gil_scoped_release>()
+        )
+        .def(
+            "load",
+            [](vhash::VHash& self, const string& path) {
+                self = vhash::VHash::load(path);
+            },
+            py::arg("path")
+        )
         .def(
             py::pickle(
                 &vhash::VHash::__get_state__,
                 &vhash::VHash::__set_state__
             )
         );
+    py::class_<vhash::VHashIndex>(m, "VHashIndex")
+        .def(
+            py::init <
+                const vhash::VHash&,
+                const string&,
+                const int&
+            >(),
+            py::arg("model"),
+            py::arg("quantize") = "none",
+            py::arg("n_jobs") = 1
+        )
+        .def(
+            "add",
+            &vhash::VHashIndex::add,
+            py::arg("docs"),
+            py::call_guard <py::gil_scoped_release>()
+        )
+        .def(
+            "add_vectors",
+            &vhash::VHashIndex::add_numpy,
+            py::arg("vectors")
+        )
+        .def(
+            "build",
+            &vhash::VHashIndex::build,
+            py::arg("num_lists"),
+            py::arg("iterations") = (size_t)10,
+            py::call_guard <py::gil_scoped_release>()
+        )
+        .def(
+            "query",
+            &vhash::VHashIndex::query_numpy,
+            py::arg("docs"),
+            py::arg("k"),
+            py::arg("num_probes") = (size_t)0
+        )
+        .def(
+            "query_vectors",
+            &vhash::VHashIndex::query_vectors_numpy,
+            py::arg("vectors"),
+            py::arg("k"),
+            py::arg("num_probes") = (size_t)0
+        )
+        .def(
+            "__len__",
+            &vhash::VHashIndex::size
+        )
+        .def_property_readonly(
+            "dimension",
+            &vhash::VHashIndex::dimension
+        )
+        .def_property_readonly(
+            "num_lists",
+            &vhash::VHashIndex::num_lists
+        )
+        .def(
+            "memory",
+            &vhash::VHashIndex::memory
+        );
+    py::class_<vhash::VHashPipeline>(m, "VHashPipeline")
+        .def(
+            py::init <
+                const vhash::VHash&,
+                const size_t&,
+                const size_t&
+            >(),
+            py::arg("model"),
+            py::arg("batch_size") = (size_t)64,
+            py::arg("num_batches") = (size_t)8
+        )
+        .def(
+            "transform",
+            &vhash::VHashPipeline::transform_numpy,
+            py::arg("docs")
+        )
+        .def(
+            "stats",
+            &vhash::VHashPipeline::stats_dict
+        )
+        .def_property_readonly(
+            "batch_size",
+            &vhash::VHashPipeline::batch_size
+        )
+        .def_property_readonly(
+            "num_batches",
+            &vhash::VHashPipeline::num_batches
+        );
 }
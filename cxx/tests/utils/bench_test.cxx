@@ -0,0 +1,78 @@
+#include <cassert>
+#include <fstream>
+#include <map>
+
+#include <utils/bench.h>
+#include <utils/text.h>
+
+using namespace utils;
+
+void test_zipf_corpus() {
+
+    // sizes
+    auto [docs, labels] = bench::zipf_corpus(200, 1000, 20, 3);
+    assert(docs.size() == 200);
+    assert(labels.size() == 200);
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+        assert(labels[doc_num] == doc_num % 3);
+        size_t num_words = text::get_words(docs[doc_num]).size();
+        assert(num_words >= 10 && num_words <= 30);
+    }
+
+    // same seed gives same corpus
+    assert(bench::zipf_corpus(200, 1000, 20, 3).first == docs);
+    assert(bench::zipf_corpus(200, 1000, 20, 3, 1, 1).first != docs);
+
+    // frequent words are shared by classes, rare words aren't
+    std::map <string, vector <size_t>> counts;
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+        for (const string& word: text::get_words(docs[doc_num])) {
+            counts[word].resize(3);
+            counts[word][labels[doc_num]]++;
+        }
+    }
+    size_t most = 0;
+    string most_common;
+    for (const auto& [word, class_counts]: counts) {
+        size_t total = class_counts[0] + class_counts[1] + class_counts[2];
+        if (total > most) {
+            most = total;
+            most_common = word;
+        }
+    }
+    assert(most > 200);
+    for (const size_t& count: counts[most_common]) {
+        assert(count > 0);
+    }
+}
+
+void test_timing() {
+    size_t calls = 0;
+    auto timing = bench::time([&]() {calls++;}, 0.01);
+    assert(timing.first == calls);
+    assert(timing.second >= 0.01);
+    assert(bench::time([]() {}, 0).first == 1);
+    assert(bench::peak_rss() > 0);
+}
+
+void test_peak_rss() {
+
+    // peak rises with memory touched
+    size_t before = bench::peak_rss();
+    {
+        vector <char> big(64 << 20, 1);
+        assert(big.back() == 1);
+        assert(bench::peak_rss() >= before + (48 << 20));
+    }
+
+    // and falls back once reset (if supported)
+    if (!std::ofstream("/proc/self/clear_refs").good()) {return;}
+    bench::reset_peak_rss();
+    assert(bench::peak_rss() < before + (48 << 20));
+}
+
+int main() {
+    test_zipf_corpus();
+    test_timing();
+    test_peak_rss();
+}
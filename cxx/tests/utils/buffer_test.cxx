@@ -0,0 +1,58 @@
+#include <cassert>
+#include <memory>
+
+#include <utils/buffer.h>
+
+using namespace utils;
+
+void test_empty() {
+    Buffer <float> buffer;
+    assert(buffer.empty());
+    assert(buffer.size() == 0);
+    assert(buffer.begin() == buffer.end());
+}
+
+void test_owned() {
+
+    // take values
+    vector <int> values = {3, 1, 4, 1, 5};
+    Buffer <int> buffer = std::move(values);
+    assert(buffer.size() == 5);
+    assert(buffer[2] == 4);
+    assert(buffer.back() == 5);
+    assert(buffer.memory() >= 5 * sizeof(int));
+
+    // copies share values, which outlive the original
+    Buffer <int> copy = buffer;
+    assert(copy.data() == buffer.data());
+    buffer = Buffer <int>();
+    assert(buffer.empty());
+    int sum = 0;
+    for (const int& value: copy) {
+        sum += value;
+    }
+    assert(sum == 14);
+}
+
+void test_view() {
+
+    // view values owned elsewhere
+    auto owner = std::make_shared <vector <double>>(vector <double>{1.5, 2.5});
+    Buffer <double> buffer(owner->data() + 1, 1, owner);
+    assert(buffer.size() == 1);
+    assert(buffer[0] == 2.5);
+    assert(buffer.memory() == sizeof(double));
+
+    // owner is kept alive
+    std::weak_ptr <vector <double>> watch = owner;
+    owner.reset();
+    assert(!watch.expired());
+    buffer = Buffer <double>();
+    assert(watch.expired());
+}
+
+int main() {
+    test_empty();
+    test_owned();
+    test_view();
+}
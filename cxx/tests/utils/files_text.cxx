@@ -1,4 +1,7 @@
 #include <cassert>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
 
 #include <utils/files.h>
 
@@ -91,9 +94,137 @@ void test_str() {
     assert(!data.compare(data2));
 }
 
+void test_mapped() {
+
+    // write file
+    ofstream ofile = files::open <ofstream>("bin/test.bin");
+    ofile << "first line\nsecond\r\n\nlast";
+    ofile.close();
+
+    // map and split
+    files::MappedFile file("bin/test.bin");
+    vector <string_view> lines = files::lines(file.view());
+    assert(lines.size() == 4);
+    assert(lines[0] == "first line");
+    assert(lines[1] == "second");
+    assert(lines[2].empty());
+    assert(lines[3] == "last");
+
+    // trailing newline doesn't add a line
+    assert(files::lines("a\nb\n").size() == 2);
+    assert(files::lines("").empty());
+
+    // move keeps mapping
+    files::MappedFile moved(std::move(file));
+    assert(file.data() == nullptr);
+    assert(moved.view().substr(0, 5) == "first");
+
+    // access patterns only change readahead, not contents
+    for (files::Access access: {files::Access::sequential, files::Access::random, files::Access::willneed}) {
+        assert(files::MappedFile("bin/test.bin", access).view() == moved.view());
+        files::MappedReader reader("bin/test.bin", access);
+        assert(reader.read <char>() == 'f');
+    }
+}
+
+void test_mapped_create() {
+
+    // create and write through mapping
+    {
+        files::MappedFile file = files::MappedFile::create("bin/test.bin", 6);
+        assert(file.size() == 6);
+        memcpy(file.data(), "abc\ndef", 6);
+    }
+
+    // read back
+    files::MappedFile file("bin/test.bin");
+    assert(file.view() == "abc\nde");
+
+    // empty files map to nothing
+    files::MappedFile::create("bin/test.bin", 0);
+    files::MappedFile empty("bin/test.bin");
+    assert(empty.size() == 0 && empty.data() == nullptr);
+
+    // missing files throw
+    bool thrown = false;
+    try {
+        files::MappedFile missing("bin/missing.bin");
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+void test_npy_header() {
+    string header = files::npy_header(3, 1000);
+    assert(header.size() % 64 == 0);
+    assert(header.substr(0, 8) == string("\x93NUMPY\x01\x00", 8));
+    assert((size_t)(unsigned char)header[8] + 10 == header.size());
+    assert(header[9] == 0);
+    assert(header.find("'shape': (3, 1000)") != string::npos);
+    assert(header.back() == '\n');
+}
+
+void test_aligned() {
+
+    // write data points and arrays
+    vector <float> data = {4, 5.6, 489, -7};
+    ofstream ofile = files::open <ofstream>("bin/test.bin");
+    files::binary_write(ofile, (uint32_t)12);
+    files::binary_write_aligned(ofile, data.data(), data.size());
+    files::binary_write_aligned(ofile, data.data(), 0);
+    files::binary_write(ofile, 'x');
+    ofile.close();
+
+    // read back, viewing arrays in place
+    files::MappedReader reader("bin/test.bin");
+    assert(reader.read <uint32_t>() == 12);
+    Buffer <float> data2 = reader.read_aligned <float>();
+    assert((size_t)data2.data() % 64 == 0);
+    assert(data2.size() == data.size());
+    for (size_t g = 0; g < data.size(); g++) {
+        assert(data[g] == data2[g]);
+    }
+    assert(reader.read_aligned <float>().empty());
+    assert(reader.read <char>() == 'x');
+
+    // reading past the end throws
+    bool thrown = false;
+    try {
+        reader.read <char>();
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+void test_aligned_bytes() {
+
+    // write to memory
+    vector <uint64_t> data = {1, 2, 3};
+    std::ostringstream stream;
+    files::binary_write(stream, 'x');
+    files::binary_write_aligned(stream, data.data(), data.size());
+
+    // read back (arrays outlive the reader)
+    Buffer <uint64_t> data2;
+    {
+        files::MappedReader reader = files::MappedReader::from_bytes(stream.str());
+        assert(reader.read <char>() == 'x');
+        data2 = reader.read_aligned <uint64_t>();
+        assert(reader.offset() == stream.str().size());
+    }
+    assert(data2.size() == 3 && data2[0] == 1 && data2[2] == 3);
+}
+
 int main() {
     test_open();
     test_single();
     test_vec();
     test_str();
+    test_mapped();
+    test_mapped_create();
+    test_npy_header();
+    test_aligned();
+    test_aligned_bytes();
 }
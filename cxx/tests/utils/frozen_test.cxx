@@ -0,0 +1,154 @@
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <utils/frozen.h>
+
+using namespace utils;
+
+void test_empty() {
+    FrozenTable frozen = FrozenTable(Table());
+    assert(frozen.empty());
+    assert(frozen.find("hi") == FrozenTable::npos);
+}
+
+void test_find() {
+    Table table;
+    table.insert("hi");
+    table.insert("my name");
+    table.insert("");
+    FrozenTable frozen(table);
+    assert(frozen.size() == 3);
+    assert(frozen.find("hi") == 0);
+    assert(frozen.find("my name") == 1);
+    assert(frozen.find("") == 2);
+    assert(frozen.find("my") == FrozenTable::npos);
+    assert(!frozen.key(1).compare("my name"));
+    assert(frozen.find_hash(hash("my name")) == 1);
+    assert(frozen.key_memory() >= 9);
+    assert(frozen.index_memory() >= 3 * 8 + 4 * sizeof(uint64_t));
+}
+
+void test_many() {
+
+    // freeze
+    Table table;
+    for (size_t g = 0; g < 100000; g++) {
+        table.insert("key " + std::to_string(g));
+    }
+    FrozenTable frozen(table);
+
+    // check all keys are found, with the same entry numbers
+    assert(frozen.size() == table.size());
+    for (size_t g = 0; g < 100000; g++) {
+        assert(frozen.find("key " + std::to_string(g)) == g);
+        assert(!frozen.key(g).compare("key " + std::to_string(g)));
+    }
+
+    // check missing keys aren't found
+    for (size_t g = 100000; g < 200000; g++) {
+        assert(frozen.find("key " + std::to_string(g)) == FrozenTable::npos);
+    }
+}
+
+void test_write_read() {
+
+    // write tables
+    Table table;
+    for (size_t g = 0; g < 1000; g++) {
+        table.insert("key " + std::to_string(g));
+    }
+    table.insert("");
+    ofstream file = files::open <ofstream>("bin/test.bin");
+    FrozenTable(table).write(file);
+    FrozenTable().write(file);
+    file.close();
+
+    // read tables back, from the mapped file
+    files::MappedReader reader("bin/test.bin");
+    FrozenTable frozen = FrozenTable::read(reader);
+    FrozenTable empty = FrozenTable::read(reader);
+    assert(frozen.size() == table.size());
+    for (size_t g = 0; g < 1000; g++) {
+        assert(frozen.find("key " + std::to_string(g)) == g);
+    }
+    assert(frozen.find("") == 1000);
+    assert(frozen.find("key 1000") == FrozenTable::npos);
+    assert(empty.empty());
+    assert(empty.find("") == FrozenTable::npos);
+
+    // truncated tables throw
+    bool thrown = false;
+    try {
+        FrozenTable::read(reader);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+// make a 16-byte key with the same unseeded hash as `key` (also 16 bytes),
+// by changing its first word and cancelling that out with its second
+string collide(const string& key) {
+    auto mix = [](uint64_t state, const uint64_t& word) {
+        state = (state ^ word) * 0xFF51AFD7ED558CCDULL;
+        return state ^ state >> 32;
+    };
+    uint64_t start = (0x9E3779B97F4A7C15ULL ^ 16) * 0xC4CEB9FE1A85EC53ULL;
+    uint64_t first, second;
+    memcpy(&first, &key[0], 8);
+    memcpy(&second, &key[8], 8);
+    uint64_t other_first = first ^ 1;
+    uint64_t other_second = mix(start, first) ^ second ^ mix(start, other_first);
+    string out(16, '\0');
+    memcpy(&out[0], &other_first, 8);
+    memcpy(&out[8], &other_second, 8);
+    return out;
+}
+
+void test_collisions() {
+
+    // keys with identical unseeded hashes
+    vector <string> keys = {"colliding key #1", "colliding key #2"};
+    for (size_t g = 0; g < 2; g++) {
+        keys.push_back(collide(keys[g]));
+        assert(keys.back() != keys[g]);
+        assert(hash(keys.back()) == hash(keys[g]));
+    }
+
+    // unseeded tables still freeze unseeded
+    Table table;
+    table.insert("key");
+    assert(!FrozenTable(table).seed());
+
+    // colliding keys are hashed with a seed instead, that separates them
+    for (const string& key: keys) {table.insert(key);}
+    FrozenTable frozen(table);
+    assert(frozen.seed());
+    for (size_t entry = 0; entry < table.size(); entry++) {
+        assert(frozen.find(table.key(entry)) == entry);
+        assert(frozen.find_hash(hash(table.key(entry), frozen.seed())) == entry);
+    }
+    assert(hash(keys[0], frozen.seed()) != hash(keys[2], frozen.seed()));
+    assert(hash("key", 0) == hash("key"));
+
+    // and is kept when written
+    ofstream file = files::open <ofstream>("bin/test.bin");
+    frozen.write(file);
+    file.close();
+    files::MappedReader reader("bin/test.bin");
+    FrozenTable read = FrozenTable::read(reader);
+    assert(read.seed() == frozen.seed());
+    for (size_t entry = 0; entry < table.size(); entry++) {
+        assert(read.find(table.key(entry)) == entry);
+    }
+}
+
+int main() {
+    test_empty();
+    test_find();
+    test_many();
+    test_write_read();
+    test_collisions();
+}
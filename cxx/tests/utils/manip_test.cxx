@@ -15,6 +15,14 @@ void test_rand_select() {
     assert(maths::max(selected) == 1);
 }
 
+void test_rand_index() {
+    for (size_t g = 0; g < 1000; g++) {
+        assert(manip::rand_index(7) < 7);
+    }
+    assert(manip::rand_index(1) == 0);
+}
+
 int main() {
     test_rand_select();
+    test_rand_index();
 }
@@ -0,0 +1,79 @@
+#include <atomic>
+#include <cassert>
+#include <stdexcept>
+
+#include <utils/parallel.h>
+
+using namespace utils;
+
+void test_num_threads() {
+    assert(parallel::num_threads(1) == 1);
+    assert(parallel::num_threads(7) == 7);
+    assert(parallel::num_threads(-1) >= 1);
+    assert(parallel::num_threads(-1000) == 1);
+
+    // 0 is rejected
+    bool thrown = false;
+    try {
+        parallel::num_threads(0);
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+void test_split() {
+
+    // small items are grouped together
+    vector <size_t> costs(100, 10);
+    vector <size_t> chunks = parallel::split(costs, 4, 100);
+    assert(chunks.front() == 0);
+    assert(chunks.back() == 100);
+    assert(chunks.size() == 11);
+    for (size_t c = 0; c < chunks.size(); c++) {
+        assert(chunks[c] == 10 * c);
+    }
+
+    // a long item gets its own chunk
+    costs[50] = 10000;
+    chunks = parallel::split(costs, 4, 100);
+    bool alone = false;
+    for (size_t c = 0; c + 1 < chunks.size(); c++) {
+        assert(chunks[c] < chunks[c+1]);
+        alone |= chunks[c] == 50 && chunks[c+1] == 51;
+    }
+    assert(alone);
+
+    // empty input
+    assert(parallel::split(vector <size_t>(), 4).size() == 1);
+}
+
+void test_for_each() {
+    vector <std::atomic <int>> runs(10000);
+    parallel::for_each(runs.size(), 4, [&](const size_t& task, const size_t& thread) {
+        assert(thread < 4);
+        runs[task]++;
+    });
+    for (const std::atomic <int>& count: runs) {
+        assert(count == 1);
+    }
+}
+
+void test_for_each_error() {
+    bool caught = false;
+    try {
+        parallel::for_each(100, 4, [](const size_t& task, const size_t&) {
+            if (task == 42) {throw std::runtime_error("failed");}
+        });
+    } catch (const std::runtime_error&) {
+        caught = true;
+    }
+    assert(caught);
+}
+
+int main() {
+    test_num_threads();
+    test_split();
+    test_for_each();
+    test_for_each_error();
+}
@@ -0,0 +1,62 @@
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#include <utils/quant.h>
+
+using namespace utils;
+
+void test_half() {
+
+    // exact values
+    for (float value: {0.f, 1.f, -2.f, 0.5f, 65504.f, 1.f / 1024, -0.f}) {
+        assert(quant::from_half(quant::to_half(value)) == value);
+    }
+    assert(quant::to_half(1) == 0x3C00);
+    assert(quant::to_half(-2) == 0xC000);
+
+    // every half round-trips (apart from nans, which stay nans)
+    for (uint32_t bits = 0; bits < 0x10000; bits++) {
+        float value = quant::from_half(bits);
+        if (std::isnan(value)) {
+            assert(std::isnan(quant::from_half(quant::to_half(value))));
+        } else {
+            assert(quant::to_half(value) == bits);
+        }
+    }
+
+    // rounding is to nearest, ties to even
+    assert(quant::to_half(1 + 1.f / 2048) == 0x3C00);
+    assert(quant::to_half(1 + 3.f / 2048) == 0x3C02);
+    assert(quant::to_half(1 + 1.f / 2048 + 1.f / 8192) == 0x3C01);
+
+    // relative error is small
+    for (float value = 1E-4; value < 6E4; value *= 1.37) {
+        float converted = quant::from_half(quant::to_half(value));
+        assert(std::fabs(converted - value) <= value / 2048);
+    }
+
+    // out of range
+    assert(quant::to_half(1E6) == 0x7C00);
+    assert(quant::to_half(-1E6) == 0xFC00);
+    assert(quant::to_half(1E-10) == 0);
+    assert(std::isinf(quant::from_half(quant::to_half(INFINITY))));
+    assert(std::isnan(quant::from_half(quant::to_half(NAN))));
+}
+
+void test_int8() {
+    float values[] = {0.5, -1.27, 0.01, 0};
+    float scale = quant::int8_scale(values, 4);
+    assert(std::fabs(scale - 0.01) < 1E-6);
+    assert(quant::to_int8(values[0], scale) == 50);
+    assert(quant::to_int8(values[1], scale) == -127);
+    assert(quant::to_int8(values[2], scale) == 1);
+    assert(quant::to_int8(values[3], scale) == 0);
+    assert(quant::to_int8(5, scale) == 127);
+    assert(quant::int8_scale(values + 3, 1) == 1);
+}
+
+int main() {
+    test_half();
+    test_int8();
+}
@@ -0,0 +1,76 @@
+#include <cassert>
+#include <stdexcept>
+#include <thread>
+
+#include <utils/queue.h>
+
+using namespace utils;
+
+void test_fifo() {
+    SpscQueue <int> queue(3);
+    assert(queue.capacity() == 3);
+    assert(queue.size() == 0);
+
+    // values come out in order, wrapping around the ring
+    int value;
+    for (int round = 0; round < 5; round++) {
+        for (int v = 0; v < 3; v++) {assert(queue.push(round * 3 + v));}
+        assert(queue.size() == 3);
+        for (int v = 0; v < 3; v++) {
+            assert(queue.pop(value));
+            assert(value == round * 3 + v);
+        }
+        assert(queue.size() == 0);
+    }
+
+    // zero capacity is rejected
+    bool caught = false;
+    try {SpscQueue <int> bad(0);}
+    catch (const std::invalid_argument&) {caught = true;}
+    assert(caught);
+}
+
+void test_close() {
+    SpscQueue <int> queue(4);
+    queue.push(1);
+    queue.push(2);
+    queue.close();
+    assert(queue.closed());
+
+    // pushes fail, but remaining values can still be popped
+    assert(!queue.push(3));
+    int value;
+    assert(queue.pop(value) && value == 1);
+    assert(queue.pop(value) && value == 2);
+    assert(!queue.pop(value));
+
+    // closing wakes a waiting consumer
+    SpscQueue <int> empty(1);
+    std::thread closer([&]() {empty.close();});
+    assert(!empty.pop(value));
+    closer.join();
+}
+
+void test_threads() {
+
+    // a small queue forces both threads to wait on each other
+    SpscQueue <size_t> queue(2);
+    constexpr size_t num_values = 100000;
+    std::thread producer([&]() {
+        for (size_t v = 0; v < num_values; v++) {queue.push(size_t(v));}
+        queue.close();
+    });
+    size_t value, expected = 0;
+    while (queue.pop(value)) {
+        assert(value == expected++);
+        assert(queue.size() <= queue.capacity());
+    }
+    assert(expected == num_values);
+    producer.join();
+}
+
+int main() {
+    test_fifo();
+    test_close();
+    test_threads();
+}
@@ -0,0 +1,43 @@
+#include <cassert>
+#include <string>
+
+#include <utils/sketch.h>
+#include <utils/table.h>
+
+using namespace utils;
+
+void test_exact() {
+    CountMin sketch(1 << 16);
+    assert(!sketch.empty());
+    assert(sketch.memory() == 1 << 16);
+    assert(sketch.estimate(hash("hi")) == 0);
+    assert(sketch.add(hash("hi")) == 1);
+    assert(sketch.add(hash("hi"), 4) == 5);
+    assert(sketch.add(hash("my")) == 1);
+    assert(sketch.estimate(hash("hi")) == 5);
+}
+
+void test_overcount() {
+
+    // count 10000 items, with item g occurring (g % 10 + 1) times
+    CountMin sketch(1 << 14);
+    size_t total = 0;
+    for (size_t g = 0; g < 10000; g++) {
+        sketch.add(hash("key " + std::to_string(g)), g % 10 + 1);
+        total += g % 10 + 1;
+    }
+
+    // never undercount, and rarely overcount by more than ~e * total / width
+    size_t num_far = 0;
+    for (size_t g = 0; g < 10000; g++) {
+        size_t estimate = sketch.estimate(hash("key " + std::to_string(g)));
+        assert(estimate >= g % 10 + 1);
+        num_far += estimate > g % 10 + 1 + 3 * total / 1024;
+    }
+    assert(num_far < 100);
+}
+
+int main() {
+    test_exact();
+    test_overcount();
+}
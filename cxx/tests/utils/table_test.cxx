@@ -0,0 +1,77 @@
+#include <cassert>
+#include <string>
+
+#include <utils/table.h>
+
+using namespace utils;
+
+void test_hash() {
+    assert(hash("hi my name") == hash(string("hi my name")));
+    assert(hash("hi my name") != hash("hi my nam"));
+    assert(hash("") != hash(string(1, '\0')));
+
+    // keys of different lengths shouldn't collide through the length seed
+    assert(hash(string("\x1f\0\0\0", 4)) != hash(string("\x13\0\0\0\0\0\0\0", 8)));
+}
+
+void test_insert() {
+    Table table;
+    assert(table.empty());
+    assert(table.find("hi") == Table::npos);
+    assert(table.insert("hi") == 0);
+    assert(table.insert("my name") == 1);
+    assert(table.insert("hi") == 0);
+    assert(table.size() == 2);
+    assert(table.find("my name") == 1);
+    assert(table.find("my") == Table::npos);
+    assert(!table.key(1).compare("my name"));
+    assert(table.insert("my name", hash("my name")) == 1);
+    assert(table.insert("is", hash("is")) == 2);
+    assert(table.find("is") == 2);
+    assert(table.memory() >= 11);
+}
+
+void test_many() {
+    Table table;
+    for (size_t g = 0; g < 10000; g++) {
+        assert(table.insert(std::to_string(g)) == g);
+    }
+    assert(table.size() == 10000);
+    for (size_t g = 0; g < 10000; g++) {
+        assert(table.find(std::to_string(g)) == g);
+        assert(!table.key(g).compare(std::to_string(g)));
+    }
+    assert(table.find("10000") == Table::npos);
+}
+
+void test_filter() {
+
+    // keep even numbers
+    Table table;
+    vector <char> keep;
+    for (size_t g = 0; g < 1000; g++) {
+        table.insert(std::to_string(g));
+        keep.push_back(g % 2 == 0);
+    }
+    table.filter(keep);
+
+    // check entries are renumbered in order
+    assert(table.size() == 500);
+    for (size_t g = 0; g < 1000; g++) {
+        size_t entry = table.find(std::to_string(g));
+        assert(entry == (g % 2? Table::npos: g / 2));
+    }
+
+    // check table is still usable
+    assert(table.insert("1") == 500);
+    assert(table.find("1") == 500);
+    table.clear();
+    assert(table.find("0") == Table::npos);
+}
+
+int main() {
+    test_hash();
+    test_insert();
+    test_many();
+    test_filter();
+}
@@ -1,4 +1,6 @@
 #include <cassert>
+#include <cctype>
+#include <cstdlib>
 
 #include <utils/text.h>
 
@@ -26,8 +28,131 @@ void test_get_phrases() {
     assert(!phrases[2].compare("name is mike"));
 }
 
+void test_format_buffer() {
+    string out = "stale contents";
+    text::format("  hi42 my email Is miKe@gmail.com  ", out);
+    assert(!out.compare("hi 42 my email is mike gmail com"));
+    text::format(" ?! ", out);
+    assert(out.empty());
+}
+
+// text::format() as originally written (four passes, quadratic)
+string reference_format(string line) {
+    for (size_t c = 0; c < line.size(); c++) {
+        if (!isalnum(line[c])) {line[c] = ' ';}
+    }
+    for (size_t c = 0; c < line.size(); c++) {
+        if (line[c] == ' ' && (c + 1 == line.size() || line[c+1] == ' ')) {line.erase(c--, 1);}
+    }
+    for (size_t c = 0; c < line.size(); c++) {
+        if (isalpha(line[c])) {line[c] = tolower(line[c]);}
+    }
+    for (size_t c = 0; c + 1 < line.size(); c++) {
+        size_t cur_score  = !!isalpha(line[c  ]) + 2 * !!isdigit(line[c  ]);
+        size_t next_score = !!isalpha(line[c+1]) + 2 * !!isdigit(line[c+1]);
+        if (cur_score + next_score == 3) {line.insert(c+1, " ");}
+    }
+    size_t start = 0, finish = line.size();
+    while (start < line.size() && line[start] == ' ') {start++;}
+    while (finish > start && line[finish-1] == ' ') {finish--;}
+    return line.substr(start, finish - start);
+}
+
+void test_format_kernels() {
+    vector <text::Simd> kernels = {text::Simd::none, text::Simd::sse42, text::Simd::avx2};
+
+    // random lines of every length (up to a few blocks), drawn from
+    // alphabets with more or fewer separators and letter/digit switches
+    vector <string> alphabets = {
+        "aB3 ",
+        "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789",
+        "Hello world, 42 times!\t\n@[`{/:\x80\xC3\xA9\xFF\x7F",
+        "ab  cd12",
+    };
+    string out;
+    for (size_t size = 0; size < 200; size++) {
+        for (const string& alphabet: alphabets) {
+            string line;
+            for (size_t c = 0; c < size; c++) {
+                line += alphabet[rand() % alphabet.size()];
+            }
+            string expected = reference_format(line);
+            for (const text::Simd& simd: kernels) {
+                text::format(line, out, simd);
+                assert(out == expected);
+            }
+        }
+    }
+
+    // every byte value, and lines longer than a block
+    string line;
+    for (size_t c = 0; c < 256; c++) {
+        line += (char)c;
+        line += (char)(255 - c);
+    }
+    string expected = reference_format(line);
+    for (const text::Simd& simd: kernels) {
+        text::format(line, out, simd);
+        assert(out == expected);
+    }
+    line.clear();
+    for (size_t c = 0; c < 200000; c++) {
+        line += alphabets[2][rand() % alphabets[2].size()];
+    }
+    expected = reference_format(line);
+    for (const text::Simd& simd: kernels) {
+        text::format(line, out, simd);
+        assert(out == expected);
+    }
+
+    // letters and digits alternating (doubling the line) over blocks
+    line.clear();
+    for (size_t c = 0; c < 150000; c++) {
+        line += c % 2? 'x': '7';
+    }
+    for (const text::Simd& simd: kernels) {
+        text::format(line, out, simd);
+        assert(out.size() == 2 * line.size() - 1);
+        assert(!out.compare(0, 6, "7 x 7 "));
+    }
+}
+
+void test_phrases() {
+    string line = "hi, my name is Mike";
+    text::Phrases phrases(1, 3);
+    phrases.parse(line);
+    assert(phrases.num_words() == 5);
+    assert(!phrases.word(4).compare("mike"));
+    assert(phrases.num_phrases() == 12);
+
+    // should yield exactly the phrases from get_phrases()
+    vector <string> yielded;
+    phrases.for_each([&](const string_view& phrase) {
+        yielded.push_back(string(phrase));
+    });
+    assert(yielded.size() == 12);
+    for (size_t phrase_len = 1; phrase_len <= 3; phrase_len++) {
+        for (const string& phrase: text::get_phrases(line, phrase_len)) {
+            size_t count = 0;
+            for (const string& other: yielded) {
+                count += !phrase.compare(other);
+            }
+            assert(count == 1);
+        }
+    }
+
+    // reparsing reuses the generator
+    phrases.parse("");
+    assert(phrases.num_words() == 0);
+    assert(phrases.num_phrases() == 0);
+    phrases.for_each([](const string_view&) {assert(false);});
+}
+
 int main() {
     test_format();
     test_get_words();
     test_get_phrases();
+    test_format_buffer();
+    test_format_kernels();
+    test_phrases();
 }
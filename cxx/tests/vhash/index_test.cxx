@@ -0,0 +1,14 @@
+#include <cassert>
+
+#include <vhash/index.h>
+
+using namespace vhash;
+
+
+void test_private() {
+    VHashIndex::_test();
+}
+
+int main() {
+    test_private();
+}
@@ -0,0 +1,14 @@
+#include <cassert>
+
+#include <vhash/pipeline.h>
+
+using namespace vhash;
+
+
+void test_private() {
+    VHashPipeline::_test();
+}
+
+int main() {
+    test_private();
+}
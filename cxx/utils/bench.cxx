@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+#include <sys/resource.h>
+
+#include <utils/bench.h>
+
+using namespace utils;
+
+
+std::pair <vector <string>, vector <size_t>> bench::zipf_corpus(
+    const size_t& num_docs,
+    const size_t& vocab_size,
+    const size_t& doc_length,
+    const size_t& num_classes,
+    const double& exponent,
+    const uint64_t& seed
+) {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution <double> uniform(0, 1);
+
+    // spell out words (as base-26 numbers, at least 2 letters long)
+    vector <string> words(vocab_size);
+    for (size_t id = 0; id < vocab_size; id++) {
+        for (size_t value = id + 26; value; value /= 26) {
+            words[id].push_back('a' + value % 26);
+        }
+    }
+
+    // cumulative distribution of ranks
+    vector <double> cdf(vocab_size);
+    double total = 0;
+    for (size_t rank = 0; rank < vocab_size; rank++) {
+        total += 1 / pow(rank + 1, exponent);
+        cdf[rank] = total;
+    }
+
+    // ranks past the shared words map to different words for each class
+    size_t num_shared = (vocab_size + 99) / 100;
+    size_t num_specific = vocab_size - num_shared;
+    size_t stride = num_classes? num_specific / num_classes: 0;
+
+    // write docs
+    vector <string> docs(num_docs);
+    vector <size_t> labels(num_docs);
+    for (size_t doc_num = 0; doc_num < num_docs; doc_num++) {
+        labels[doc_num] = num_classes? doc_num % num_classes: 0;
+        size_t length = doc_length / 2 + rng() % (doc_length + 1);
+        string& doc = docs[doc_num];
+        for (size_t word_num = 0; word_num < length; word_num++) {
+
+            // draw word
+            double target = uniform(rng) * total;
+            size_t rank = std::lower_bound(cdf.begin(), cdf.end(), target) - cdf.begin();
+            if (rank >= vocab_size) {rank = vocab_size - 1;}
+            size_t id = rank < num_shared? rank: num_shared + (rank - num_shared + labels[doc_num] * stride) % num_specific;
+
+            // add word, with occasional punctuation
+            if (word_num) {doc += rng() % 10? " ": ", ";}
+            doc += words[id];
+        }
+        if (!doc.empty()) {
+            doc[0] = toupper(doc[0]);
+            doc += '.';
+        }
+    }
+    return {docs, labels};
+}
+
+size_t bench::peak_rss() {
+
+    // read high-water mark (which reset_peak_rss() resets), if on Linux
+    FILE* file = fopen("/proc/self/status", "r");
+    if (file) {
+        char line[256];
+        size_t kb;
+        while (fgets(line, sizeof(line), file)) {
+            if (sscanf(line, "VmHWM: %zu kB", &kb) == 1) {
+                fclose(file);
+                return kb * 1024;
+            }
+        }
+        fclose(file);
+    }
+
+    // otherwise, get lifetime peak
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (size_t)usage.ru_maxrss * 1024;
+}
+
+void bench::reset_peak_rss() {
+    FILE* file = fopen("/proc/self/clear_refs", "w");
+    if (!file) {return;}
+    fputs("5", file);
+    fclose(file);
+}
+
+void bench::report_header() {
+    printf(
+        "%-24s %10s %8s %12s %12s %10s %10s\n",
+        "benchmark", "ops/call", "calls", "latency(us)", "docs/s", "MB/s", "RSS(MB)"
+    );
+}
+
+void bench::report(
+    const string& name,
+    const size_t& ops,
+    const size_t& docs,
+    const size_t& bytes,
+    const std::pair <size_t, double>& timing
+) {
+    // throughputs only apply to benchmarks that process text
+    double seconds = timing.second / timing.first;
+    char docs_per_second[32] = "-", mb_per_second[32] = "-";
+    if (docs) {snprintf(docs_per_second, sizeof(docs_per_second), "%.0f", docs / seconds);}
+    if (bytes) {snprintf(mb_per_second, sizeof(mb_per_second), "%.1f", bytes / seconds / 1E6);}
+    printf(
+        "%-24s %10zu %8zu %12.3f %12s %10s %10.1f\n",
+        name.c_str(),
+        ops,
+        timing.first,
+        1E6 * seconds / (ops? ops: 1),
+        docs_per_second,
+        mb_per_second,
+        peak_rss() / 1E6
+    );
+    fflush(stdout);
+}
@@ -0,0 +1,127 @@
+#ifndef UTILS_BENCH_H
+#define UTILS_BENCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+
+namespace utils {
+    namespace bench {
+
+        /* Generate a synthetic labeled corpus, with Zipf-distributed words
+
+        Word ranks follow Zipf's law (rank `r` has probability proportional
+        to `1 / r^exponent`). The most frequent 1% of words are shared by all
+        classes; the rest of the ranks map to different words for each
+        class, so classes can be told apart by their vocabulary. Words are
+        lowercase letters; each document starts with a capital, and contains
+        some punctuation, so it exercises text::format().
+
+        Parameters
+        ----------
+        num_docs: const size_t&
+            number of documents
+        vocab_size: const size_t&
+            number of distinct words
+        doc_length: const size_t&
+            mean number of words per document (lengths are uniform, from
+            half to one and a half times this)
+        num_classes: const size_t&
+            number of classes (labels are dealt out in turn)
+        exponent: const double&
+            Zipf exponent (larger values concentrate on frequent words)
+        seed: const uint64_t&
+            random seed (the same seed gives the same corpus)
+
+        Returns
+        -------
+        std::pair <vector <string>, vector <size_t>>
+            documents, and the class label of each
+         */
+        std::pair <vector <string>, vector <size_t>> zipf_corpus(
+            const size_t& num_docs,
+            const size_t& vocab_size,
+            const size_t& doc_length,
+            const size_t& num_classes,
+            const double& exponent = 1,
+            const uint64_t& seed = 0
+        );
+
+        /* Peak resident set size of this process
+
+        Returns
+        -------
+        size_t
+            peak RSS since the last reset_peak_rss() (or since the process
+            started, if it can't be reset), in bytes
+         */
+        size_t peak_rss();
+
+        /* Reset peak resident set size to the current one
+
+        Only supported on Linux (by writing to /proc/self/clear_refs);
+        elsewhere, peak_rss() keeps reporting the lifetime peak.
+         */
+        void reset_peak_rss();
+
+        /* Time a function, calling it repeatedly for at least `min_seconds`
+
+        Resets the peak RSS first, so report() gives the peak while timing.
+
+        Template
+        --------
+        F
+            callable, called as `func()`
+
+        Parameters
+        ----------
+        func: F&&
+            function to time
+        min_seconds: const double&
+            minimum total time to run for (the function is always called at
+            least once)
+
+        Returns
+        -------
+        std::pair <size_t, double>
+            number of calls, and total time taken (in seconds)
+         */
+        template <class F>
+        std::pair <size_t, double> time(F&& func, const double& min_seconds);
+
+        /* Print header for report() lines */
+        void report_header();
+
+        /* Print throughput and latency of a benchmark, and peak RSS since it
+        started timing
+
+        Parameters
+        ----------
+        name: const string&
+            name of benchmark
+        ops: const size_t&
+            number of operations per call
+        docs: const size_t&
+            number of documents processed per call
+        bytes: const size_t&
+            number of bytes of text processed per call
+        timing: const std::pair <size_t, double>&
+            number of calls and total time (as from time())
+         */
+        void report(
+            const string& name,
+            const size_t& ops,
+            const size_t& docs,
+            const size_t& bytes,
+            const std::pair <size_t, double>& timing
+        );
+    }
+}
+#include <utils/bench.hxx>
+#endif
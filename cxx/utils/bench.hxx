@@ -0,0 +1,19 @@
+#ifdef UTILS_BENCH_H
+
+#include <chrono>
+
+template <class F>
+std::pair <size_t, double> utils::bench::time(F&& func, const double& min_seconds) {
+    reset_peak_rss();
+    auto start = std::chrono::steady_clock::now();
+    size_t calls = 0;
+    double elapsed = 0;
+    do {
+        func();
+        calls++;
+        elapsed = std::chrono::duration <double>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < min_seconds);
+    return {calls, elapsed};
+}
+
+#endif
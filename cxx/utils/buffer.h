@@ -0,0 +1,95 @@
+#ifndef UTILS_BUFFER_H
+#define UTILS_BUFFER_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+using std::vector;
+
+
+namespace utils {
+
+    /* Read-only array, that either owns its values or views memory owned
+    elsewhere (e.g. a memory-mapped file)
+
+    Copies share the same values (which are never modified), so copying is
+    cheap. Whatever owns the values is kept alive until the last copy is
+    destroyed.
+
+    Template
+    --------
+    Z
+        data type (must be trivially copyable, to be viewed in a file)
+     */
+    template <class Z>
+    class Buffer {
+        public:
+
+            // ===============================================================
+            // Constructors
+
+            /* Empty constructor */
+            Buffer() {}
+
+            /* Take ownership of values
+
+            Parameters
+            ----------
+            values: vector <Z>&&
+                values to own
+             */
+            Buffer(vector <Z>&& values);
+
+            /* View values owned by another object
+
+            Parameters
+            ----------
+            data: const Z*
+                first value
+            size: const size_t&
+                number of values
+            owner: const std::shared_ptr <const void>&
+                object owning the values (kept alive by this buffer)
+             */
+            Buffer(
+                const Z* data,
+                const size_t& size,
+                const std::shared_ptr <const void>& owner
+            );
+
+            // ===============================================================
+            // Access
+
+            const Z& operator[](const size_t& pos) const {return _data[pos];}
+            const Z& back() const {return _data[_size - 1];}
+            const Z* data() const {return _data;}
+            const Z* begin() const {return _data;}
+            const Z* end() const {return _data + _size;}
+
+            // ===============================================================
+            // Meta-data
+
+            /* Number of values */
+            size_t size() const {return _size;}
+
+            /* Check if buffer is empty */
+            bool empty() const {return !_size;}
+
+            /* Memory used by values, in bytes
+
+            For owned values, this includes any unused capacity of the
+            vector they came from. For viewed values, this is just their size
+            (e.g. pages of a mapped file, which may be shared).
+             */
+            size_t memory() const {return _memory;}
+
+        private:
+            const Z* _data = nullptr;
+            size_t _size = 0;
+            size_t _memory = 0;
+            std::shared_ptr <const void> _owner;
+    };
+}
+#include <utils/buffer.hxx>
+#endif
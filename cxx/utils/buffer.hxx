@@ -0,0 +1,22 @@
+#ifdef UTILS_BUFFER_H
+
+#include <utility>
+
+template <class Z>
+utils::Buffer<Z>::Buffer(vector <Z>&& values) {
+    auto owned = std::make_shared <const vector <Z>>(std::move(values));
+    _data = owned->data();
+    _size = owned->size();
+    _memory = owned->capacity() * sizeof(Z);
+    _owner = owned;
+}
+
+template <class Z>
+utils::Buffer<Z>::Buffer(
+    const Z* data,
+    const size_t& size,
+    const std::shared_ptr <const void>& owner
+): _data(data), _size(size), _memory(size * sizeof(Z)), _owner(owner) {
+}
+
+#endif
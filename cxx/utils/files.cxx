@@ -1,3 +1,10 @@
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <utils/files.h>
 
 using namespace utils;
@@ -12,8 +19,140 @@ string files::binary_read <string>(ifstream& file) {
 }
 
 template <>
-void files::binary_write <string>(ofstream& file, const string& pt) {
+void files::binary_write <string>(ostream& file, const string& pt) {
     size_t size = pt.size();
     binary_write(file, size);
     file.write((char*)&pt[0], size);
 }
+
+files::MappedFile::MappedFile(const string& fname, const Access& access) {
+    int fd = ::open(fname.c_str(), O_RDONLY);
+    if (fd < 0) {throw std::runtime_error("Could not open file: " + fname);}
+    struct stat info;
+    if (fstat(fd, &info) < 0) {
+        ::close(fd);
+        throw std::runtime_error("Could not stat file: " + fname);
+    }
+    _map(fd, info.st_size, &access);
+}
+
+files::MappedFile files::MappedFile::create(const string& fname, const size_t& size) {
+    int fd = ::open(fname.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {throw std::runtime_error("Could not create file: " + fname);}
+    if (ftruncate(fd, size) < 0) {
+        ::close(fd);
+        throw std::runtime_error("Could not resize file: " + fname);
+    }
+    MappedFile out;
+    out._map(fd, size, nullptr);
+    return out;
+}
+
+files::MappedFile::MappedFile(MappedFile&& other) {
+    *this = std::move(other);
+}
+
+files::MappedFile& files::MappedFile::operator=(MappedFile&& other) {
+    if (this != &other) {
+        if (_data) {munmap(_data, _size);}
+        _data = other._data;
+        _size = other._size;
+        other._data = nullptr;
+        other._size = 0;
+    }
+    return *this;
+}
+
+files::MappedFile::~MappedFile() {
+    if (_data) {munmap(_data, _size);}
+}
+
+void files::MappedFile::_map(const int& fd, const size_t& size, const Access* access) {
+
+    // mmap can't map an empty file
+    if (!size) {
+        ::close(fd);
+        return;
+    }
+
+    // map file (the mapping stays valid after closing its descriptor)
+    int prot = access? PROT_READ: PROT_READ | PROT_WRITE;
+    void* data = mmap(nullptr, size, prot, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {throw std::runtime_error("Could not map file");}
+    _data = (char*)data;
+    _size = size;
+
+    // tune readahead to how the file will be read
+    if (access) {
+        int advice = (
+            *access == Access::sequential? MADV_SEQUENTIAL:
+            *access == Access::random? MADV_RANDOM:
+            MADV_WILLNEED
+        );
+        madvise(_data, _size, advice);
+    }
+}
+
+vector <string_view> files::lines(const string_view& text) {
+    vector <string_view> out;
+    size_t start = 0;
+    while (start < text.size()) {
+
+        // find end of line
+        size_t end = text.find('\n', start);
+        if (end == string_view::npos) {end = text.size();}
+
+        // strip carriage return
+        size_t stop = end;
+        if (stop > start && text[stop - 1] == '\r') {stop--;}
+        out.push_back(text.substr(start, stop - start));
+        start = end + 1;
+    }
+    return out;
+}
+
+string files::npy_header(const size_t& rows, const size_t& cols) {
+
+    // describe array
+    string dict =
+        "{'descr': '<f4', 'fortran_order': False, 'shape': (" +
+        std::to_string(rows) + ", " + std::to_string(cols) + "), }";
+
+    // pad with spaces, ending in a newline, so data is aligned
+    size_t size = 10 + dict.size() + 1;
+    dict.append((64 - size % 64) % 64, ' ');
+    dict.push_back('\n');
+
+    // magic string, version, and header length (little-endian)
+    size_t length = dict.size();
+    string out("\x93NUMPY\x01\x00", 8);
+    out.append(1, (char)(length & 0xFF));
+    out.append(1, (char)(length >> 8));
+    return out + dict;
+}
+
+files::MappedReader::MappedReader(const string& fname, const Access& access) {
+    auto file = std::make_shared <const MappedFile>(fname, access);
+    _data = file->data();
+    _size = file->size();
+    _owner = file;
+}
+
+files::MappedReader files::MappedReader::from_bytes(string&& bytes) {
+    auto owned = std::make_shared <const string>(std::move(bytes));
+    MappedReader out;
+    out._data = owned->data();
+    out._size = owned->size();
+    out._owner = owned;
+    return out;
+}
+
+const char* files::MappedReader::_take(const size_t& size) {
+    if (size > _size - _offset) {
+        throw std::runtime_error("Unexpected end of file");
+    }
+    const char* out = _data + _offset;
+    _offset += size;
+    return out;
+}
@@ -1,13 +1,22 @@
 #ifndef UTILS_FILES_H
 #define UTILS_FILES_H
 
+#include <cstddef>
+#include <cstdint>
 #include <fstream>
+#include <memory>
+#include <ostream>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include <utils/buffer.h>
+
 using std::ifstream;
 using std::ofstream;
+using std::ostream;
 using std::string;
+using std::string_view;
 using std::vector;
 
 namespace utils {
@@ -90,16 +99,16 @@ namespace utils {
 
         Parameters
         ----------
-        file: ofstream&
-            file handler
+        file: ostream&
+            output stream (e.g. file handler)
         pt: const Z&
             data point to write
         */
         template <class Z>
-        void binary_write(ofstream& file, const Z& pt);
+        void binary_write(ostream& file, const Z& pt);
 
         template <>
-        void binary_write <string>(ofstream& file, const string& pt);
+        void binary_write <string>(ostream& file, const string& pt);
 
         /* Write a vector to a binary file
 
@@ -110,13 +119,246 @@ namespace utils {
 
         Parameters
         ----------
-        file: ofstream&
-            file handler
+        file: ostream&
+            output stream (e.g. file handler)
         pts: const vector <Z>&
             vector to write
         */
         template <class Z> 
-        void binary_write(ofstream& file, const vector <Z>& pts);
+        void binary_write(ostream& file, const vector <Z>& pts);
+
+        /* Write an array to a binary file, aligned for viewing once mapped
+
+        Writes the number of values (as a uint64_t), then pads with zeros
+        so the values start on a 64-byte boundary (from the start of the
+        file), then writes the values. Read back with MappedReader.
+
+        Template
+        --------
+        Z
+            data type (trivially copyable)
+
+        Parameters
+        ----------
+        file: ostream&
+            output stream (e.g. file handler)
+        data: const Z*
+            first value to write
+        size: const size_t&
+            number of values
+        */
+        template <class Z>
+        void binary_write_aligned(ostream& file, const Z* data, const size_t& size);
+
+        /* Expected order of reads from a mapped file (a hint to the kernel,
+        which sizes its readahead to match)
+
+        sequential: read front to back (e.g. documents, one per line)
+        random: read in any order, so only the pages touched are read
+        willneed: read in any order, but most of it soon, so the whole file
+            is read ahead in the background (e.g. a model's arrays)
+         */
+        enum class Access {sequential, random, willneed};
+
+        /* Memory-mapped file
+
+        Maps a whole file into memory, so its contents can be read (or
+        written) in place, without copying them into a buffer. The mapping
+        is released when the object is destroyed. Move-only.
+         */
+        class MappedFile {
+            public:
+
+                /* Empty constructor */
+                MappedFile() {}
+
+                /* Map existing file, read-only
+
+                Parameters
+                ----------
+                fname: const string&
+                    file to map
+                access: const Access&
+                    how the file will be read
+
+                Raises
+                ------
+                std::runtime_error
+                    if can't open or map file
+                 */
+                MappedFile(const string& fname, const Access& access = Access::sequential);
+
+                /* Create (or truncate) file of given size, and map it read-write
+
+                Parameters
+                ----------
+                fname: const string&
+                    file to create
+                size: const size_t&
+                    size of file, in bytes
+
+                Returns
+                -------
+                MappedFile
+                    writeable mapping of the new file
+
+                Raises
+                ------
+                std::runtime_error
+                    if can't create or map file
+                 */
+                static MappedFile create(const string& fname, const size_t& size);
+
+                MappedFile(MappedFile&& other);
+                MappedFile& operator=(MappedFile&& other);
+                MappedFile(const MappedFile&) = delete;
+                MappedFile& operator=(const MappedFile&) = delete;
+                ~MappedFile();
+
+                /* Start of mapped memory (nullptr if file is empty) */
+                char* data() const {return _data;}
+
+                /* Size of mapped file, in bytes */
+                size_t size() const {return _size;}
+
+                /* Contents of mapped file */
+                string_view view() const {return string_view(_data, _size);}
+
+            private:
+                char* _data = nullptr;
+                size_t _size = 0;
+
+                // map open file descriptor (closing it), read-only with the
+                // given access pattern, or read-write if `access` is nullptr
+                void _map(const int& fd, const size_t& size, const Access* access);
+        };
+
+        /* Sequential reader of a memory-mapped binary file (or of bytes in
+        memory, laid out the same way)
+
+        Reads data points (copied out, like binary_read) and arrays (viewed
+        in place, without copying) from the start of the file onwards.
+         */
+        class MappedReader {
+            public:
+
+                /* Map file for reading
+
+                Parameters
+                ----------
+                fname: const string&
+                    file to read
+                access: const Access&
+                    how arrays viewed in the file will be read
+
+                Raises
+                ------
+                std::runtime_error
+                    if can't open or map file
+                 */
+                MappedReader(const string& fname, const Access& access = Access::random);
+
+                /* Read bytes in memory, taking ownership of them
+
+                Parameters
+                ----------
+                bytes: string&&
+                    contents of a file (e.g. written to a std::ostringstream)
+                 */
+                static MappedReader from_bytes(string&& bytes);
+
+                /* Read 1 data point
+
+                Template
+                --------
+                Z
+                    data type
+
+                Returns
+                -------
+                Z
+                    data pt
+
+                Raises
+                ------
+                std::runtime_error
+                    if the file ends first
+                 */
+                template <class Z>
+                Z read();
+
+                /* View an array written by binary_write_aligned
+
+                Template
+                --------
+                Z
+                    data type
+
+                Returns
+                -------
+                Buffer <Z>
+                    values, viewed in the mapped file (which the buffer
+                    keeps mapped)
+
+                Raises
+                ------
+                std::runtime_error
+                    if the file ends first
+                 */
+                template <class Z>
+                Buffer <Z> read_aligned();
+
+                /* Number of bytes read so far */
+                size_t offset() const {return _offset;}
+
+            private:
+                MappedReader() {}
+
+                // whatever owns the bytes being read (kept alive by buffers)
+                std::shared_ptr <const void> _owner;
+                const char* _data = nullptr;
+                size_t _size = 0;
+                size_t _offset = 0;
+
+                // get next `size` bytes, advancing past them
+                const char* _take(const size_t& size);
+        };
+
+        /* Split text into lines, without copying
+
+        Handles both "\n" and "\r\n" line endings. A trailing newline
+        doesn't start another (empty) line.
+
+        Parameters
+        ----------
+        text: const string_view&
+            text to split (e.g. MappedFile::view())
+
+        Returns
+        -------
+        vector <string_view>
+            lines of text, pointing into `text`
+         */
+        vector <string_view> lines(const string_view& text);
+
+        /* Header of a .npy (version 1.0) file holding a float32 matrix
+
+        Data follows the header, in row-major order. The header is padded
+        so that the data starts on a 64-byte boundary.
+
+        Parameters
+        ----------
+        rows: const size_t&
+            number of rows
+        cols: const size_t&
+            number of columns
+
+        Returns
+        -------
+        string
+            header bytes
+         */
+        string npy_header(const size_t& rows, const size_t& cols);
     }
 }
 #include <utils/files.hxx>
@@ -1,5 +1,8 @@
 #ifdef UTILS_FILES_H
 
+#include <cstring>
+#include <stdexcept>
+
 template <class Z>
 Z utils::files::open(const string& fname) {
 	Z file;
@@ -30,14 +33,40 @@ vector <Z> utils::files::binary_read_vec(ifstream& file) {
 }
 
 template <class Z>
-void utils::files::binary_write(ofstream& file, const Z& data) {
+void utils::files::binary_write(ostream& file, const Z& data) {
 	file.write((char*)&data, sizeof(Z)); // write single data point
 }
 
 template <class Z>
-void utils::files::binary_write(ofstream& file, const vector <Z>& data) {
+void utils::files::binary_write(ostream& file, const vector <Z>& data) {
 	binary_write <uint32_t>(file, data.size());           // write size of data
 	file.write((char*)&data[0], sizeof(Z) * data.size()); // write data
 }
 
+template <class Z>
+void utils::files::binary_write_aligned(ostream& file, const Z* data, const size_t& size) {
+	binary_write <uint64_t>(file, size);               // write size of data
+	size_t padding = (64 - file.tellp() % 64) % 64;
+	file.write(string(padding, 0).data(), padding);    // align data
+	file.write((const char*)data, sizeof(Z) * size);   // write data
+}
+
+template <class Z>
+Z utils::files::MappedReader::read() {
+	Z out;
+	memcpy(&out, _take(sizeof(Z)), sizeof(Z));
+	return out;
+}
+
+template <class Z>
+utils::Buffer <Z> utils::files::MappedReader::read_aligned() {
+	uint64_t size = read <uint64_t>();
+	_take((64 - _offset % 64) % 64);
+	if (size > (_size - _offset) / sizeof(Z)) {
+		throw std::runtime_error("Unexpected end of file");
+	}
+	const Z* data = (const Z*)_take(sizeof(Z) * size);
+	return Buffer <Z>(data, size, _owner);
+}
+
 #endif
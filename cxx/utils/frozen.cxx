@@ -0,0 +1,203 @@
+#include <cstring>
+#include <random>
+#include <stdexcept>
+
+#include <utils/frozen.h>
+
+using namespace utils;
+
+
+FrozenTable::FrozenTable(const Table& table) {
+
+    // store keys
+    size_t num_keys = table.size();
+    vector <uint64_t> offsets(num_keys + 1);
+    vector <char> blob;
+    for (size_t entry = 0; entry < num_keys; entry++) {
+        string_view key = table.key(entry);
+        offsets[entry] = blob.size();
+        blob.insert(blob.end(), key.begin(), key.end());
+    }
+    offsets[num_keys] = blob.size();
+    _offsets = std::move(offsets);
+    _blob = std::move(blob);
+    if (!num_keys) {return;}
+
+    // hash keys and place them, retrying with random seeds if they can't be
+    // placed (e.g. if keys were crafted to have identical unseeded hashes)
+    vector <uint64_t> hashes(num_keys);
+    std::random_device random;
+    for (size_t attempt = 0;; attempt++) {
+        if (attempt == _max_attempts) {
+            throw std::runtime_error("Cannot freeze table: keys can't be placed");
+        }
+        _seed = attempt? (uint64_t)random() << 32 | random(): 0;
+        for (size_t entry = 0; entry < num_keys; entry++) {
+            hashes[entry] = hash(key(entry), _seed);
+        }
+        if (_place(hashes)) {return;}
+    }
+}
+
+bool FrozenTable::_place(const vector <uint64_t>& hashes) {
+
+    // group keys by bucket (~4 keys per bucket)
+    size_t num_keys = hashes.size();
+    size_t num_buckets = (num_keys + 3) / 4;
+    vector <uint32_t> pilots(num_buckets, 0);
+    vector <size_t> bucket_start(num_buckets + 1, 0);
+    for (const uint64_t& h: hashes) {
+        bucket_start[_bucket(h, num_buckets) + 1]++;
+    }
+    for (size_t bucket = 0; bucket < num_buckets; bucket++) {
+        bucket_start[bucket + 1] += bucket_start[bucket];
+    }
+    vector <uint32_t> bucket_keys(num_keys);
+    {
+        vector <size_t> fill(bucket_start.begin(), bucket_start.end() - 1);
+        for (size_t entry = 0; entry < num_keys; entry++) {
+            bucket_keys[fill[_bucket(hashes[entry], num_buckets)]++] = entry;
+        }
+    }
+
+    // order buckets from largest to smallest (counting sort)
+    size_t max_size = 0;
+    for (size_t bucket = 0; bucket < num_buckets; bucket++) {
+        size_t size = bucket_start[bucket + 1] - bucket_start[bucket];
+        if (size > max_size) {max_size = size;}
+    }
+    vector <vector <uint32_t>> buckets_of_size(max_size + 1);
+    for (size_t bucket = 0; bucket < num_buckets; bucket++) {
+        buckets_of_size[bucket_start[bucket + 1] - bucket_start[bucket]].push_back(bucket);
+    }
+
+    // place buckets, largest first
+    vector <Slot> slots(num_keys, Slot{0, 0});
+    vector <char> taken(num_keys, false);
+    vector <size_t> positions;
+    size_t next_free = 0;
+    for (size_t size = max_size; size > 0; size--) {
+        for (const uint32_t& bucket: buckets_of_size[size]) {
+            const uint32_t* keys = &bucket_keys[bucket_start[bucket]];
+
+            // single keys go straight into the next free slot
+            if (size == 1) {
+                while (taken[next_free]) {next_free++;}
+                pilots[bucket] = _direct | next_free;
+                positions.assign(1, next_free);
+            }
+
+            // otherwise, search for a pilot that sends keys to free slots
+            else {
+
+                // identical hashes could never be separated
+                for (size_t a = 0; a < size; a++) {
+                    for (size_t b = a + 1; b < size; b++) {
+                        if (hashes[keys[a]] == hashes[keys[b]]) {return false;}
+                    }
+                }
+
+                // search
+                for (uint32_t pilot = 0;; pilot++) {
+                    if (pilot == _direct) {return false;}
+                    positions.clear();
+                    for (size_t k = 0; k < size; k++) {
+                        size_t pos = _slot(hashes[keys[k]], pilot, num_keys);
+                        bool collides = taken[pos];
+                        for (size_t prev = 0; prev < k && !collides; prev++) {
+                            collides = positions[prev] == pos;
+                        }
+                        if (collides) {break;}
+                        positions.push_back(pos);
+                    }
+                    if (positions.size() == size) {
+                        pilots[bucket] = pilot;
+                        break;
+                    }
+                }
+            }
+
+            // fill slots
+            for (size_t k = 0; k < size; k++) {
+                taken[positions[k]] = true;
+                slots[positions[k]] = Slot{(uint32_t)hashes[keys[k]], keys[k]};
+            }
+        }
+    }
+    _pilots = std::move(pilots);
+    _slots = std::move(slots);
+    return true;
+}
+
+void FrozenTable::write(ostream& file) const {
+    files::binary_write <uint64_t>(file, _seed);
+    files::binary_write_aligned(file, _pilots.data(), _pilots.size());
+    files::binary_write_aligned(file, _slots.data(), _slots.size());
+    files::binary_write_aligned(file, _blob.data(), _blob.size());
+    files::binary_write_aligned(file, _offsets.data(), _offsets.size());
+}
+
+FrozenTable FrozenTable::read(files::MappedReader& reader) {
+
+    // view arrays
+    FrozenTable out;
+    out._seed = reader.read <uint64_t>();
+    out._pilots = reader.read_aligned <uint32_t>();
+    out._slots = reader.read_aligned <Slot>();
+    out._blob = reader.read_aligned <char>();
+    out._offsets = reader.read_aligned <uint64_t>();
+
+    // check that lookups stay in bounds (an empty table may have no offsets)
+    size_t num_keys = out._slots.size();
+    bool valid = (
+        out._pilots.size() == (num_keys + 3) / 4 &&
+        out._offsets.size() == (num_keys || !out._offsets.empty()? num_keys + 1: 0) &&
+        (out._offsets.empty()? out._blob.empty(): !out._offsets[0] && out._offsets.back() == out._blob.size())
+    );
+    for (size_t entry = 0; valid && entry < num_keys; entry++) {
+        valid = out._offsets[entry] <= out._offsets[entry + 1] && out._slots[entry].entry < num_keys;
+    }
+    for (size_t bucket = 0; valid && bucket < out._pilots.size(); bucket++) {
+        const uint32_t& pilot = out._pilots[bucket];
+        valid = !(pilot & _direct) || (pilot & ~_direct) < num_keys;
+    }
+    if (!valid) {throw std::runtime_error("Cannot read table: malformed data");}
+    return out;
+}
+
+size_t FrozenTable::find(const string_view& key_) const {
+
+    // check fingerprint, then key
+    size_t entry = find_hash(hash(key_, _seed));
+    if (entry == npos) {return npos;}
+    uint64_t start = _offsets[entry];
+    uint64_t size = _offsets[entry + 1] - start;
+    if (size != key_.size() || memcmp(_blob.data() + start, key_.data(), size)) {return npos;}
+    return entry;
+}
+
+size_t FrozenTable::find_hash(const uint64_t& hash) const {
+    if (_slots.empty()) {return npos;}
+
+    // get slot
+    uint32_t pilot = _pilots[_bucket(hash, _pilots.size())];
+    const Slot& slot = _slots[pilot & _direct? pilot & ~_direct: _slot(hash, pilot, _slots.size())];
+
+    // check fingerprint
+    if (slot.fingerprint != (uint32_t)hash) {return npos;}
+    return slot.entry;
+}
+
+string_view FrozenTable::key(const size_t& entry) const {
+    return string_view(_blob.data() + _offsets[entry], _offsets[entry + 1] - _offsets[entry]);
+}
+
+size_t FrozenTable::_bucket(const uint64_t& hash, const size_t& num_buckets) {
+    return ((hash >> 32) * num_buckets) >> 32;
+}
+
+size_t FrozenTable::_slot(const uint64_t& hash, const uint32_t& pilot, const size_t& num_slots) {
+    uint64_t mixed = (hash ^ (pilot * 0x9E3779B97F4A7C15ULL)) * 0xFF51AFD7ED558CCDULL;
+    mixed ^= mixed >> 29;
+    return ((mixed >> 32) * num_slots) >> 32;
+}
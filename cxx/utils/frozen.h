@@ -0,0 +1,236 @@
+#ifndef UTILS_FROZEN_H
+#define UTILS_FROZEN_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <utils/buffer.h>
+#include <utils/files.h>
+#include <utils/table.h>
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+
+namespace utils {
+
+    /* Read-only hash table, optimized for lookups
+
+    Built once from a utils::Table, keeping the same entry numbers. Keys are
+    placed with a minimal perfect hash function: each key hashes to a bucket,
+    and each bucket stores a pilot value that sends all of its keys to
+    distinct slots. There are exactly as many slots as keys.
+
+    Each slot holds a 32-bit fingerprint of its key's hash and the key's entry
+    number, so a lookup reads one pilot and one slot, and only compares key
+    bytes (stored back-to-back in one blob) when the fingerprint matches.
+
+    Keys are hashed unseeded if possible. If they can't be placed (two keys
+    with identical hashes can never be separated, and such keys are easy to
+    construct), they're hashed again with a random seed, which the table
+    keeps.
+
+    All of this lives in flat arrays, so a table written to a file can be
+    used straight from the mapped file, without rebuilding it.
+     */
+    class FrozenTable {
+        public:
+
+            /* entry number returned when a key isn't found */
+            static constexpr size_t npos = SIZE_MAX;
+
+            // ===============================================================
+            // Constructors
+
+            /* Empty constructor */
+            FrozenTable() {}
+
+            /* Freeze table
+
+            Parameters
+            ----------
+            table: const Table&
+                table to freeze
+
+            Raises
+            ------
+            std::runtime_error
+                if keys can't be placed with any of several seeds
+             */
+            FrozenTable(const Table& table);
+
+            // ===============================================================
+            // Serialization
+
+            /* Write table to a binary file
+
+            Parameters
+            ----------
+            file: ostream&
+                output stream (e.g. file handler)
+             */
+            void write(ostream& file) const;
+
+            /* Read table written by write(), viewing it in the mapped file
+
+            Parameters
+            ----------
+            reader: files::MappedReader&
+                reader, positioned at the start of the table
+
+            Returns
+            -------
+            FrozenTable
+                table (keeping the file mapped)
+
+            Raises
+            ------
+            std::runtime_error
+                if the file ends first, or the table is malformed
+             */
+            static FrozenTable read(files::MappedReader& reader);
+
+            // ===============================================================
+            // Access
+
+            /* Find key
+
+            Parameters
+            ----------
+            key: const string_view&
+                key to find
+
+            Returns
+            -------
+            size_t
+                entry number of key, or npos if not in table
+             */
+            size_t find(const string_view& key) const;
+
+            /* Find key by its hash alone, without comparing key bytes
+
+            Only the 32-bit fingerprint is checked, so a hash that isn't in
+            the table can (rarely) return some other entry. Callers needing
+            an exact answer should compare the full hash of the returned
+            entry's key.
+
+            Parameters
+            ----------
+            hash: const uint64_t&
+                hash of key (as from `utils::hash(key, seed())`)
+
+            Returns
+            -------
+            size_t
+                entry number of candidate key, or npos if not in table
+             */
+            size_t find_hash(const uint64_t& hash) const;
+
+            /* Get key of entry
+
+            Parameters
+            ----------
+            entry: const size_t&
+                entry number
+
+            Returns
+            -------
+            string_view
+                key
+             */
+            string_view key(const size_t& entry) const;
+
+            // ===============================================================
+            // Meta-data
+
+            /* Seed that keys are hashed with
+
+            Returns
+            -------
+            uint64_t
+                seed (0 if keys are hashed unseeded)
+             */
+            uint64_t seed() const {return _seed;}
+
+            /* Number of entries in table
+
+            Returns
+            -------
+            size_t
+                number of entries
+             */
+            size_t size() const {return _slots.size();}
+
+            /* Check if table is empty
+
+            Returns
+            -------
+            bool
+                True if table is empty
+             */
+            bool empty() const {return _slots.empty();}
+
+            /* Memory used by keys, in bytes
+
+            Returns
+            -------
+            size_t
+                size of the blob of keys
+             */
+            size_t key_memory() const {return _blob.memory();}
+
+            /* Memory used to find keys, in bytes
+
+            Returns
+            -------
+            size_t
+                size of pilots, slots and key offsets
+             */
+            size_t index_memory() const {
+                return _pilots.memory() + _slots.memory() + _offsets.memory();
+            }
+
+        private:
+
+            // fingerprint and entry number of key placed in slot
+            struct Slot {
+                uint32_t fingerprint;
+                uint32_t entry;
+            };
+
+            // flags a pilot that directly stores a slot number
+            static constexpr uint32_t _direct = 0x80000000;
+
+            // seeds to try before giving up on placing keys
+            static constexpr size_t _max_attempts = 16;
+
+            // seed that keys are hashed with
+            uint64_t _seed = 0;
+
+            // pilot for each bucket
+            Buffer <uint32_t> _pilots;
+
+            // one slot per key
+            Buffer <Slot> _slots;
+
+            // keys, stored back-to-back (in entry order)
+            Buffer <char> _blob;
+
+            // start of each key in _blob, plus the end of the last key
+            Buffer <uint64_t> _offsets;
+
+            // place keys by their hashes, setting pilots and slots (returning
+            // false if they can't be placed)
+            bool _place(const vector <uint64_t>& hashes);
+
+            // get bucket of hash, out of `num_buckets`
+            static size_t _bucket(const uint64_t& hash, const size_t& num_buckets);
+
+            // get slot of hash (out of `num_slots`), given its bucket's pilot
+            static size_t _slot(const uint64_t& hash, const uint32_t& pilot, const size_t& num_slots);
+    };
+}
+#endif
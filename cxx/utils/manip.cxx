@@ -1,3 +1,4 @@
+#include <cstdint>
 #include <cstdlib>
 
 #include <utils/manip.h>
@@ -17,3 +18,8 @@ vector <char> manip::rand_select(const size_t& pool_size, const size_t& num_sele
     }
     return out;
 }
+
+size_t manip::rand_index(const size_t& pool_size) {
+    uint64_t value = ((uint64_t)rand() << 31) ^ rand();
+    return value % pool_size;
+}
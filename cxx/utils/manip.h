@@ -1,6 +1,7 @@
 #ifndef UTILS_MANIP_H
 #define UTILS_MANIP_H
 
+#include <cstddef>
 #include <vector>
 
 using std::vector;
@@ -27,6 +28,20 @@ namespace utils {
             const size_t& pool_size,
             const size_t& num_select
         );
+
+        /* Select a random index
+
+        Parameters
+        ----------
+        pool_size: const size_t&
+            total number of possible choices (may exceed RAND_MAX)
+
+        Returns
+        -------
+        size_t
+            random index in [0, pool_size)
+         */
+        size_t rand_index(const size_t& pool_size);
     }
 }
 #endif
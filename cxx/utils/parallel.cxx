@@ -0,0 +1,53 @@
+#include <stdexcept>
+#include <thread>
+
+#include <utils/parallel.h>
+
+using namespace utils;
+
+
+size_t parallel::num_threads(const int& n_jobs) {
+    if (!n_jobs) {throw std::invalid_argument("n_jobs must not be 0");}
+    if (n_jobs > 0) {return n_jobs;}
+    int hardware = std::thread::hardware_concurrency();
+    if (hardware < 1) {hardware = 1;}
+    int out = hardware + 1 + n_jobs;
+    return out < 1? 1: out;
+}
+
+vector <size_t> parallel::split(
+    const vector <size_t>& costs,
+    const size_t& num_threads,
+    const size_t& min_cost
+) {
+    // get total cost
+    size_t total = 0;
+    for (const size_t& cost: costs) {
+        total += cost;
+    }
+
+    // aim for several chunks per thread, so stealing can balance the load
+    size_t target = total / (8 * (num_threads? num_threads: 1));
+    if (target < min_cost) {target = min_cost;}
+
+    // cut chunks
+    vector <size_t> out = {0};
+    size_t running = 0;
+    for (size_t item = 0; item < costs.size(); item++) {
+
+        // start a new chunk, rather than overfill this one
+        if (running && running + costs[item] > target) {
+            out.push_back(item);
+            running = 0;
+        }
+
+        // add item, closing chunk if full
+        running += costs[item];
+        if (running >= target) {
+            out.push_back(item + 1);
+            running = 0;
+        }
+    }
+    if (out.back() != costs.size()) {out.push_back(costs.size());}
+    return out;
+}
@@ -0,0 +1,87 @@
+#ifndef UTILS_PARALLEL_H
+#define UTILS_PARALLEL_H
+
+#include <cstddef>
+#include <vector>
+
+using std::vector;
+
+
+namespace utils {
+    namespace parallel {
+
+        /* Resolve number of threads to use
+
+        Follows the scikit-learn convention: positive values are used as-is,
+        and negative values count back from the number of hardware threads
+        (-1 uses all of them, -2 all but one, etc.). 0 is rejected, rather
+        than silently meaning one more thread than there are cores.
+
+        Parameters
+        ----------
+        n_jobs: const int&
+            requested number of threads
+
+        Returns
+        -------
+        size_t
+            number of threads to use (at least 1)
+
+        Raises
+        ------
+        std::invalid_argument
+            if n_jobs is 0
+         */
+        size_t num_threads(const int& n_jobs);
+
+        /* Split a sequence of items into contiguous chunks of similar cost
+
+        Parameters
+        ----------
+        costs: const vector <size_t>&
+            cost of each item (e.g. document length in bytes)
+        num_threads: const size_t&
+            number of threads that will process chunks
+        min_cost: const size_t&
+            minimum cost of a chunk (to keep per-chunk overhead small)
+
+        Returns
+        -------
+        vector <size_t>
+            chunk boundaries: chunk `c` covers items `[out[c], out[c+1])`
+         */
+        vector <size_t> split(
+            const vector <size_t>& costs,
+            const size_t& num_threads,
+            const size_t& min_cost = 1 << 16
+        );
+
+        /* Run tasks on a pool of work-stealing threads
+
+        Tasks are dealt out to threads in contiguous blocks. Each thread works
+        through its own block from the front; a thread that runs out steals
+        the back half of the largest remaining block. Runs inline (without
+        spawning threads) if there is only one thread or one task.
+
+        If any task throws, remaining tasks are skipped, and the first
+        exception is rethrown on the calling thread.
+
+        Parameters
+        ----------
+        num_tasks: const size_t&
+            number of tasks
+        num_threads: const size_t&
+            number of threads to use
+        func: F&&
+            callable, called as `func(task_num, thread_num)`
+         */
+        template <class F>
+        void for_each(
+            const size_t& num_tasks,
+            const size_t& num_threads,
+            F&& func
+        );
+    }
+}
+#include <utils/parallel.hxx>
+#endif
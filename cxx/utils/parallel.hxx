@@ -0,0 +1,105 @@
+#ifdef UTILS_PARALLEL_H
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+template <class F>
+void utils::parallel::for_each(
+    const size_t& num_tasks,
+    const size_t& num_threads_,
+    F&& func
+) {
+    // run inline, if there's nothing to parallelize
+    size_t num_threads = num_threads_ < num_tasks? num_threads_: num_tasks;
+    if (num_threads <= 1) {
+        for (size_t task = 0; task < num_tasks; task++) {
+            func(task, 0);
+        }
+        return;
+    }
+
+    // deal out tasks in contiguous blocks
+    struct Block {
+        std::mutex lock;
+        size_t front;
+        size_t back;
+    };
+    vector <Block> blocks(num_threads);
+    for (size_t thread = 0; thread < num_threads; thread++) {
+        blocks[thread].front = num_tasks * thread / num_threads;
+        blocks[thread].back = num_tasks * (thread + 1) / num_threads;
+    }
+
+    // error handling
+    std::atomic <bool> failed(false);
+    std::exception_ptr error;
+    std::mutex error_lock;
+
+    // worker loop
+    auto work = [&](const size_t& thread) {
+        Block& own = blocks[thread];
+        while (!failed) {
+
+            // take task from front of own block
+            size_t task = SIZE_MAX;
+            {
+                std::lock_guard <std::mutex> guard(own.lock);
+                if (own.front < own.back) {task = own.front++;}
+            }
+
+            // otherwise, steal back half of largest block
+            if (task == SIZE_MAX) {
+                size_t victim = thread, most = 0;
+                for (size_t other = 0; other < num_threads; other++) {
+                    std::lock_guard <std::mutex> guard(blocks[other].lock);
+                    size_t remaining = blocks[other].back - blocks[other].front;
+                    if (remaining > most) {
+                        victim = other;
+                        most = remaining;
+                    }
+                }
+                if (!most) {return;}
+                size_t stolen_front, stolen_back;
+                {
+                    std::lock_guard <std::mutex> guard(blocks[victim].lock);
+                    size_t remaining = blocks[victim].back - blocks[victim].front;
+                    if (!remaining) {continue;}
+                    stolen_back = blocks[victim].back;
+                    stolen_front = stolen_back - (remaining + 1) / 2;
+                    blocks[victim].back = stolen_front;
+                }
+                std::lock_guard <std::mutex> guard(own.lock);
+                own.front = stolen_front;
+                own.back = stolen_back;
+                continue;
+            }
+
+            // run task
+            try {
+                func(task, thread);
+            } catch (...) {
+                std::lock_guard <std::mutex> guard(error_lock);
+                if (!failed) {error = std::current_exception();}
+                failed = true;
+            }
+        }
+    };
+
+    // run threads (using the calling thread as thread 0)
+    vector <std::thread> threads;
+    for (size_t thread = 1; thread < num_threads; thread++) {
+        threads.emplace_back(work, thread);
+    }
+    work(0);
+    for (std::thread& thread: threads) {
+        thread.join();
+    }
+
+    // propagate errors
+    if (error) {std::rethrow_exception(error);}
+}
+
+#endif
@@ -0,0 +1,88 @@
+#include <cmath>
+#include <cstring>
+
+#include <utils/quant.h>
+
+using namespace utils;
+
+
+uint16_t quant::to_half(const float& value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign = (bits >> 16) & 0x8000;
+    uint32_t exponent = (bits >> 23) & 0xFF;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    // infinity and nan (keeping nans quiet)
+    if (exponent == 0xFF) {
+        return sign | 0x7C00 | (mantissa? 0x200 | (mantissa >> 13): 0);
+    }
+
+    // rebias exponent
+    int32_t half_exponent = (int32_t)exponent - 127 + 15;
+
+    // too large: infinity
+    if (half_exponent >= 0x1F) {return sign | 0x7C00;}
+
+    // too small for a normal half: subnormal (or zero)
+    if (half_exponent <= 0) {
+        if (half_exponent < -10) {return sign;}
+        mantissa |= 0x800000;
+        uint32_t shift = 14 - half_exponent;
+        uint32_t half_mantissa = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half_mantissa & 1))) {half_mantissa++;}
+        return sign | half_mantissa;
+    }
+
+    // normal: round mantissa to nearest, ties to even (carries roll into the
+    // exponent, up to infinity)
+    uint32_t out = ((uint32_t)half_exponent << 10) | (mantissa >> 13);
+    uint32_t remainder = mantissa & 0x1FFF;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (out & 1))) {out++;}
+    return sign | out;
+}
+
+float quant::from_half(const uint16_t& half) {
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+
+    // assemble float bits
+    uint32_t bits;
+    if (exponent == 0x1F) {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    } else if (exponent) {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    } else if (!mantissa) {
+        bits = sign;
+    } else {
+
+        // subnormal: normalize
+        exponent = 127 - 15 + 1;
+        while (!(mantissa & 0x400)) {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+    }
+    float out;
+    memcpy(&out, &bits, sizeof(out));
+    return out;
+}
+
+float quant::int8_scale(const float* values, const size_t& size) {
+    float largest = 0;
+    for (size_t g = 0; g < size; g++) {
+        if (std::fabs(values[g]) > largest) {largest = std::fabs(values[g]);}
+    }
+    return largest? largest / 127: 1;
+}
+
+int8_t quant::to_int8(const float& value, const float& scale) {
+    float scaled = std::round(value / scale);
+    if (scaled > 127) {return 127;}
+    if (scaled < -127) {return -127;}
+    return (int8_t)scaled;
+}
@@ -0,0 +1,79 @@
+#ifndef UTILS_QUANT_H
+#define UTILS_QUANT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using std::vector;
+
+
+namespace utils {
+    namespace quant {
+
+        /* Convert float to half precision (IEEE 754 binary16)
+
+        Rounds to nearest (ties to even). Values too large for half
+        precision become infinity.
+
+        Parameters
+        ----------
+        value: const float&
+            value to convert
+
+        Returns
+        -------
+        uint16_t
+            bits of half-precision value
+         */
+        uint16_t to_half(const float& value);
+
+        /* Convert half precision (IEEE 754 binary16) to float
+
+        Parameters
+        ----------
+        bits: const uint16_t&
+            bits of half-precision value
+
+        Returns
+        -------
+        float
+            value (exactly)
+         */
+        float from_half(const uint16_t& bits);
+
+        /* Scale for quantizing values to int8
+
+        Parameters
+        ----------
+        values: const float*
+            values to quantize
+        size: const size_t&
+            number of values
+
+        Returns
+        -------
+        float
+            scale, such that `value / scale` is in [-127, 127] for each value
+            (1, if all values are 0)
+         */
+        float int8_scale(const float* values, const size_t& size);
+
+        /* Quantize value to int8
+
+        Parameters
+        ----------
+        value: const float&
+            value to quantize
+        scale: const float&
+            scale (as from int8_scale)
+
+        Returns
+        -------
+        int8_t
+            `value / scale`, rounded to nearest, and clamped to [-127, 127]
+         */
+        int8_t to_int8(const float& value, const float& scale);
+    }
+}
+#endif
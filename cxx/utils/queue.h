@@ -0,0 +1,110 @@
+#ifndef UTILS_QUEUE_H
+#define UTILS_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+using std::vector;
+
+
+namespace utils {
+
+    /* Bounded lock-free queue, for one producer thread and one consumer thread
+
+    Values are kept in a fixed ring of slots. The producer only writes the
+    tail, and the consumer only writes the head, so neither ever takes a
+    lock. A full (or empty) queue is waited on by spinning briefly, then
+    yielding the thread.
+
+    Either side can close the queue: after that, pushes fail, and pops fail
+    once the remaining values have been taken. This lets a pipeline stage
+    signal that it has finished (or failed), without a sentinel value.
+
+    Template
+    --------
+    Z
+        value type (must be default-constructible and movable)
+     */
+    template <class Z>
+    class SpscQueue {
+        public:
+
+            /* Constructor
+
+            Parameters
+            ----------
+            capacity: const size_t&
+                maximum number of values held at once (at least 1)
+             */
+            SpscQueue(const size_t& capacity);
+
+            /* Add a value to the back of the queue, waiting while it's full
+
+            Only call from the producer thread.
+
+            Parameters
+            ----------
+            value: Z&&
+                value to add
+
+            Returns
+            -------
+            bool
+                false (without adding the value), if the queue was closed
+             */
+            bool push(Z&& value);
+
+            /* Take a value from the front of the queue, waiting while it's empty
+
+            Only call from the consumer thread.
+
+            Parameters
+            ----------
+            value: Z&
+                output: value taken
+
+            Returns
+            -------
+            bool
+                false, if the queue is closed and empty
+             */
+            bool pop(Z& value);
+
+            /* Close the queue (may be called from either thread) */
+            void close() {_closed.store(true, std::memory_order_release);}
+
+            // ===============================================================
+            // Meta-data
+
+            /* Number of values in the queue (a snapshot, if other threads are
+            pushing or popping) */
+            size_t size() const {
+                return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+            }
+
+            /* Maximum number of values held at once */
+            size_t capacity() const {return _slots.size();}
+
+            /* Check if queue has been closed */
+            bool closed() const {return _closed.load(std::memory_order_acquire);}
+
+        private:
+
+            // ring of values: value `n` is in slot `n % capacity`
+            vector <Z> _slots;
+
+            // number of values ever popped and pushed (on separate cache
+            // lines, as they're written by different threads)
+            alignas(64) std::atomic <size_t> _head {0};
+            alignas(64) std::atomic <size_t> _tail {0};
+
+            // whether queue has been closed
+            alignas(64) std::atomic <bool> _closed {false};
+
+            // wait a little longer, on the `attempt`th time of waiting
+            static void _wait(const size_t& attempt);
+    };
+}
+#include <utils/queue.hxx>
+#endif
@@ -0,0 +1,49 @@
+#ifdef UTILS_QUEUE_H
+
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+template <class Z>
+utils::SpscQueue<Z>::SpscQueue(const size_t& capacity): _slots(capacity) {
+    if (!capacity) {
+        throw std::invalid_argument("queue capacity must be at least 1");
+    }
+}
+
+template <class Z>
+bool utils::SpscQueue<Z>::push(Z&& value) {
+    size_t tail = _tail.load(std::memory_order_relaxed);
+    for (size_t attempt = 0; ; attempt++) {
+        if (closed()) {return false;}
+        if (tail - _head.load(std::memory_order_acquire) < _slots.size()) {break;}
+        _wait(attempt);
+    }
+    _slots[tail % _slots.size()] = std::move(value);
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+template <class Z>
+bool utils::SpscQueue<Z>::pop(Z& value) {
+    size_t head = _head.load(std::memory_order_relaxed);
+    for (size_t attempt = 0; ; attempt++) {
+
+        // check closed before checking for values, so values pushed before
+        // closing are always seen
+        bool was_closed = closed();
+        if (_tail.load(std::memory_order_acquire) != head) {break;}
+        if (was_closed) {return false;}
+        _wait(attempt);
+    }
+    value = std::move(_slots[head % _slots.size()]);
+    _head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+template <class Z>
+void utils::SpscQueue<Z>::_wait(const size_t& attempt) {
+    if (attempt >= 64) {std::this_thread::yield();}
+}
+
+#endif
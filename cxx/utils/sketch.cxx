@@ -0,0 +1,40 @@
+#include <utils/sketch.h>
+
+using namespace utils;
+
+
+CountMin::CountMin(const size_t& memory, const size_t& depth) {
+    _width = memory / (depth * sizeof(uint32_t));
+    if (!_width) {_width = 1;}
+    _cells.assign(_width * depth, 0);
+}
+
+size_t CountMin::add(const uint64_t& hash, const size_t& count) {
+
+    // get new estimate
+    uint64_t out = (uint64_t)estimate(hash) + count;
+    if (out > UINT32_MAX) {out = UINT32_MAX;}
+
+    // raise cells that are below it
+    for (size_t row = 0; row * _width < _cells.size(); row++) {
+        uint32_t& cell = _cells[_cell(hash, row)];
+        if (cell < out) {cell = out;}
+    }
+    return out;
+}
+
+size_t CountMin::estimate(const uint64_t& hash) const {
+    uint32_t out = UINT32_MAX;
+    for (size_t row = 0; row * _width < _cells.size(); row++) {
+        uint32_t cell = _cells[_cell(hash, row)];
+        if (cell < out) {out = cell;}
+    }
+    return out;
+}
+
+size_t CountMin::_cell(const uint64_t& hash, const size_t& row) const {
+
+    // double hashing: combine the two halves of the hash differently per row
+    uint32_t mixed = (uint32_t)hash + row * (uint32_t)((hash >> 32) | 1);
+    return row * _width + ((uint64_t)mixed * _width >> 32);
+}
@@ -0,0 +1,107 @@
+#ifndef UTILS_SKETCH_H
+#define UTILS_SKETCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using std::vector;
+
+
+namespace utils {
+
+    /* Count-Min sketch, for approximately counting items in fixed memory
+
+    Each item (given by its 64-bit hash) is counted in one cell of each of
+    `depth` rows, and its count is estimated as the minimum of those cells.
+    Estimates never undercount, and overcount by at most e/width of the
+    total count (with probability 1 - e^-depth). Cells are updated conservatively
+    (only raised as far as needed), which tightens estimates further.
+     */
+    class CountMin {
+        public:
+
+            // ===============================================================
+            // Constructors
+
+            /* Empty constructor */
+            CountMin() {}
+
+            /* Make sketch, using a given amount of memory
+
+            Parameters
+            ----------
+            memory: const size_t&
+                size of sketch, in bytes
+            depth: const size_t&
+                number of rows (i.e. cells per item)
+             */
+            CountMin(const size_t& memory, const size_t& depth = 4);
+
+            // ===============================================================
+            // Counting
+
+            /* Count item
+
+            Parameters
+            ----------
+            hash: const uint64_t&
+                hash of item
+            count: const size_t&
+                number of times to count item
+
+            Returns
+            -------
+            size_t
+                estimated count of item, including this count
+             */
+            size_t add(const uint64_t& hash, const size_t& count = 1);
+
+            /* Estimate count of item
+
+            Parameters
+            ----------
+            hash: const uint64_t&
+                hash of item
+
+            Returns
+            -------
+            size_t
+                estimated count of item (never less than its true count)
+             */
+            size_t estimate(const uint64_t& hash) const;
+
+            // ===============================================================
+            // Meta-data
+
+            /* Size of sketch
+
+            Returns
+            -------
+            size_t
+                size of sketch, in bytes
+             */
+            size_t memory() const {return _cells.size() * sizeof(uint32_t);}
+
+            /* Check if sketch has no cells
+
+            Returns
+            -------
+            bool
+                True if sketch has no cells
+             */
+            bool empty() const {return _cells.empty();}
+
+        private:
+
+            // cells in each row
+            size_t _width = 0;
+
+            // rows of cells, back-to-back (counts saturate at UINT32_MAX)
+            vector <uint32_t> _cells;
+
+            // get position of item's cell in row
+            size_t _cell(const uint64_t& hash, const size_t& row) const;
+    };
+}
+#endif
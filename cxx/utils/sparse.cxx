@@ -35,17 +35,6 @@ float Sparse::dot_product(const vector <float>& multiplier) const {
     return out;
 }
 
-Sparse Sparse::multiply(
-    const vector <float>& multiplier,
-    const bool& in_place
-) {
-    Sparse out = in_place? *this: Sparse(*this);
-    for (size_t g = 0; g < num_nonzero(); g++) {
-        out.values[g] *= multiplier[indices[g]];
-    }
-    return out;
-}
-
 Sparse Sparse::normalize() const {
     return Sparse(
         max_index,
@@ -87,9 +87,14 @@ namespace utils {
 
             /* Elementwise multiplication
 
+            Template
+            --------
+            V
+                dense vector type (e.g. vector <float> or Buffer <float>)
+
             Parameters
             ----------
-            multiplier: const vector <float>&
+            multiplier: const V&
                 Vector to use in computing inner product
             in_place: bool
                 Whether operation should be done in place
@@ -99,8 +104,9 @@ namespace utils {
             Sparse
                 resulting vector (or calling object, if `in_place`)
              */
+            template <class V>
             Sparse multiply(
-                const vector <float>& multiplier,
+                const V& multiplier,
                 const bool& in_place = false
             );
 
@@ -9,4 +9,16 @@ utils::Sparse::Sparse(const vector <Z>& dense): max_index(dense.size()) {
     }
 }
 
+template <class V>
+utils::Sparse utils::Sparse::multiply(
+    const V& multiplier,
+    const bool& in_place
+) {
+    Sparse out = in_place? *this: Sparse(*this);
+    for (size_t g = 0; g < num_nonzero(); g++) {
+        out.values[g] *= multiplier[indices[g]];
+    }
+    return out;
+}
+
 #endif
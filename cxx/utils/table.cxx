@@ -0,0 +1,155 @@
+#include <cstring>
+#include <utility>
+
+#include <utils/table.h>
+
+using namespace utils;
+
+
+uint64_t utils::hash(const string_view& key, const uint64_t& seed) {
+
+    // mix in 8 bytes at a time
+    const char* data = key.data();
+    size_t size = key.size();
+    // (spread size over all bits, so it can't be cancelled by the first word)
+    uint64_t out = (0x9E3779B97F4A7C15ULL ^ size) * 0xC4CEB9FE1A85EC53ULL;
+    out ^= seed * 0xFF51AFD7ED558CCDULL;
+    while (size) {
+        uint64_t word = 0;
+        size_t num_bytes = size < 8? size: 8;
+        memcpy(&word, data, num_bytes);
+        out = (out ^ word) * 0xFF51AFD7ED558CCDULL;
+        out ^= out >> 32;
+        data += num_bytes;
+        size -= num_bytes;
+    }
+
+    // finalize (MurmurHash3's fmix64)
+    out ^= out >> 33;
+    out *= 0xFF51AFD7ED558CCDULL;
+    out ^= out >> 33;
+    out *= 0xC4CEB9FE1A85EC53ULL;
+    out ^= out >> 33;
+    return out;
+}
+
+size_t Table::find(const string_view& key) const {
+    return _find(key, _tag(key));
+}
+
+size_t Table::insert(const string_view& key) {
+    return insert(key, hash(key));
+}
+
+size_t Table::insert(const string_view& key, const uint64_t& hash) {
+
+    // check if key is already present
+    uint32_t tag = hash >> 32;
+    size_t existing = _find(key, tag);
+    if (existing != npos) {return existing;}
+
+    // grow slot array (keeping load factor <= 7/8)
+    if ((_entries.size() + 1) * 8 > _slots.size() * 7) {
+        _rehash(_slots.empty()? 16: 2 * _slots.size());
+    }
+
+    // add entry
+    size_t entry = _entries.size();
+    _entries.push_back(Entry{_arena.size(), (uint32_t)key.size(), tag});
+    _arena.append(key.data(), key.size());
+    _place(tag, entry);
+    return entry;
+}
+
+string_view Table::key(const size_t& entry) const {
+    return string_view(&_arena[_entries[entry].offset], _entries[entry].size);
+}
+
+void Table::filter(const vector <char>& keep) {
+
+    // compact entries and arena (in a single sweep)
+    size_t num_kept = 0;
+    uint64_t arena_size = 0;
+    for (size_t entry_num = 0; entry_num < _entries.size(); entry_num++) {
+        if (!keep[entry_num]) {continue;}
+        Entry entry = _entries[entry_num];
+        memmove(&_arena[arena_size], &_arena[entry.offset], entry.size);
+        entry.offset = arena_size;
+        arena_size += entry.size;
+        _entries[num_kept++] = entry;
+    }
+    _entries.resize(num_kept);
+    _arena.resize(arena_size);
+
+    // rebuild slot array, leaving room to grow
+    size_t num_slots = 16;
+    while (num_slots < 2 * num_kept) {num_slots *= 2;}
+    _rehash(num_slots);
+}
+
+void Table::reserve(const size_t& num_entries) {
+    _entries.reserve(num_entries);
+    size_t num_slots = _slots.empty()? 16: _slots.size();
+    while (num_entries * 8 > num_slots * 7) {num_slots *= 2;}
+    if (num_slots != _slots.size()) {_rehash(num_slots);}
+}
+
+void Table::clear() {
+    _arena.clear();
+    _entries.clear();
+    _slots.clear();
+}
+
+uint32_t Table::_tag(const string_view& key) {
+    return hash(key) >> 32;
+}
+
+size_t Table::_find(const string_view& key, const uint32_t& tag) const {
+    if (_slots.empty()) {return npos;}
+    size_t mask = _slots.size() - 1;
+    for (size_t pos = tag & mask, dist = 0;; pos = (pos + 1) & mask, dist++) {
+
+        // empty: key isn't present
+        const Slot& slot = _slots[pos];
+        if (slot.entry == _empty) {return npos;}
+
+        // slot's occupant is closer to home than key would be: key isn't
+        // present (robin hood invariant)
+        if (((pos - slot.tag) & mask) < dist) {return npos;}
+
+        // check for match
+        if (slot.tag != tag) {continue;}
+        const Entry& entry = _entries[slot.entry];
+        if (entry.size == key.size() && !memcmp(&_arena[entry.offset], key.data(), key.size())) {
+            return slot.entry;
+        }
+    }
+}
+
+void Table::_place(uint32_t tag, uint32_t entry) {
+    size_t mask = _slots.size() - 1;
+    for (size_t pos = tag & mask, dist = 0;; pos = (pos + 1) & mask, dist++) {
+
+        // take empty slot
+        Slot& slot = _slots[pos];
+        if (slot.entry == _empty) {
+            slot = Slot{tag, entry};
+            return;
+        }
+
+        // take from the rich (robin hood), and keep placing the displaced entry
+        size_t slot_dist = (pos - slot.tag) & mask;
+        if (slot_dist < dist) {
+            std::swap(slot.tag, tag);
+            std::swap(slot.entry, entry);
+            dist = slot_dist;
+        }
+    }
+}
+
+void Table::_rehash(const size_t& num_slots) {
+    _slots.assign(num_slots, Slot{0, _empty});
+    for (size_t entry_num = 0; entry_num < _entries.size(); entry_num++) {
+        _place(_entries[entry_num].tag, entry_num);
+    }
+}
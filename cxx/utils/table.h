@@ -0,0 +1,220 @@
+#ifndef UTILS_TABLE_H
+#define UTILS_TABLE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+
+namespace utils {
+
+    /* hash a string of bytes
+
+    Reads 8 bytes at a time, so short keys (e.g. packed integers) hash in
+    one or two multiplies. The hash isn't cryptographic: without a seed,
+    colliding keys are easy to construct.
+
+    Parameters
+    ----------
+    key: const string_view&
+        bytes to hash
+    seed: const uint64_t&
+        seed (0 gives the unseeded hash, which tables use)
+
+    Returns
+    -------
+    uint64_t
+        64-bit hash
+     */
+    uint64_t hash(const string_view& key, const uint64_t& seed = 0);
+
+    /* Flat, open-addressing hash table of byte-string keys
+
+    Each key is assigned an entry number when inserted. Entry numbers are
+    dense (0 through size() - 1) and follow insertion order, so values can be
+    stored by the caller in plain vectors indexed by entry number.
+
+    Keys are stored back-to-back in a single arena. Lookups use Robin Hood
+    probing over a flat array of slots, each holding a 32-bit hash tag and an
+    entry number, so most misses are rejected without touching the arena.
+     */
+    class Table {
+        public:
+
+            /* entry number returned when a key isn't found */
+            static constexpr size_t npos = SIZE_MAX;
+
+            // ===============================================================
+            // Constructors
+
+            /* Empty constructor */
+            Table() {}
+
+            // ===============================================================
+            // Access
+
+            /* Find key
+
+            Parameters
+            ----------
+            key: const string_view&
+                key to find
+
+            Returns
+            -------
+            size_t
+                entry number of key, or npos if not in table
+             */
+            size_t find(const string_view& key) const;
+
+            /* Insert key, if it isn't already in the table
+
+            Parameters
+            ----------
+            key: const string_view&
+                key to insert
+
+            Returns
+            -------
+            size_t
+                entry number of key. If this equals size() - 1 after the call
+                (and didn't before), then key was newly inserted.
+             */
+            size_t insert(const string_view& key);
+
+            /* Insert key, with a precomputed hash
+
+            Parameters
+            ----------
+            key: const string_view&
+                key to insert
+            hash: const uint64_t&
+                hash of key (must equal `utils::hash(key)`)
+
+            Returns
+            -------
+            size_t
+                entry number of key
+             */
+            size_t insert(const string_view& key, const uint64_t& hash);
+
+            /* Get key of entry
+
+            Parameters
+            ----------
+            entry: const size_t&
+                entry number
+
+            Returns
+            -------
+            string_view
+                key (valid until table is modified)
+             */
+            string_view key(const size_t& entry) const;
+
+            // ===============================================================
+            // Modification
+
+            /* Remove entries
+
+            Surviving entries keep their relative order, and are renumbered
+            sequentially. This is a single sweep over the entries and the
+            arena, followed by rebuilding the slot array.
+
+            Parameters
+            ----------
+            keep: const vector <char>&
+                whether to keep each entry (indexed by entry number)
+             */
+            void filter(const vector <char>& keep);
+
+            /* Reserve space
+
+            Parameters
+            ----------
+            num_entries: const size_t&
+                number of entries to make room for
+             */
+            void reserve(const size_t& num_entries);
+
+            /* Remove all entries */
+            void clear();
+
+            // ===============================================================
+            // Meta-data
+
+            /* Number of entries in table
+
+            Returns
+            -------
+            size_t
+                number of entries
+             */
+            size_t size() const {return _entries.size();}
+
+            /* Check if table is empty
+
+            Returns
+            -------
+            bool
+                True if table is empty
+             */
+            bool empty() const {return _entries.empty();}
+
+            /* Memory used by table
+
+            Returns
+            -------
+            size_t
+                size of keys, entries and slots, in bytes
+             */
+            size_t memory() const {
+                return _arena.size() + _entries.size() * sizeof(Entry) + _slots.size() * sizeof(Slot);
+            }
+
+        private:
+
+            // location and hash tag of a key in the arena
+            struct Entry {
+                uint64_t offset;
+                uint32_t size;
+                uint32_t tag;
+            };
+
+            // position in the open-addressing array
+            struct Slot {
+                uint32_t tag;
+                uint32_t entry;
+            };
+
+            // marks an empty slot
+            static constexpr uint32_t _empty = UINT32_MAX;
+
+            // keys, stored back-to-back
+            string _arena;
+
+            // entries, in insertion order
+            vector <Entry> _entries;
+
+            // open-addressing array (size is a power of 2)
+            vector <Slot> _slots;
+
+            // get hash tag of key
+            static uint32_t _tag(const string_view& key);
+
+            // find entry number of key (or npos)
+            size_t _find(const string_view& key, const uint32_t& tag) const;
+
+            // place entry into slot array
+            void _place(uint32_t tag, uint32_t entry);
+
+            // resize slot array, and re-place all entries
+            void _rehash(const size_t& num_slots);
+    };
+}
+#endif
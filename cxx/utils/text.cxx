@@ -1,47 +1,229 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
 #include <utils/text.h>
 
 using namespace utils;
 
 
-string text::format(string line) {
+// class of each byte: 0 for separators, 1 for letters, 2 for digits (ASCII
+// only, as isalnum() in the C locale)
+static constexpr std::array <uint8_t, 256> _byte_classes() {
+    std::array <uint8_t, 256> out = {};
+    for (int c = 'a'; c <= 'z'; c++) {out[c] = 1;}
+    for (int c = 'A'; c <= 'Z'; c++) {out[c] = 1;}
+    for (int c = '0'; c <= '9'; c++) {out[c] = 2;}
+    return out;
+}
+static constexpr std::array <uint8_t, 256> _classes = _byte_classes();
 
-    // Remove non-alphanumeric characters
-    for (size_t c = 0; c < line.size(); c++) {
-        if (isalnum(line[c])) {continue;}
-        line[c] = ' ';
+// Formatting keeps letters and digits (lowercased), and writes one space at
+// the first separator after a word, and between a letter and a digit. Spaces
+// are written eagerly (when the separator is seen), so a line that ends in a
+// separator gets one trailing space, which format() removes. `last` is the
+// class of the previous byte, and carries across calls.
+//
+// Each kernel formats `size` bytes into `out` (which must have room for
+// `2 * size` bytes, plus 16 if using SIMD), returning the number written.
+static size_t _format_scalar(const char* line, const size_t& size, char* out, uint8_t& last) {
+    size_t written = 0;
+    for (size_t c = 0; c < size; c++) {
+        uint8_t byte = line[c];
+        uint8_t cls = _classes[byte];
+        if (last && cls != last) {out[written++] = ' ';}
+        if (cls) {out[written++] = byte | (cls == 1? 0x20: 0);}
+        last = cls;
     }
+    return written;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
 
-    // Remove repeated whitespace
-    for (size_t c = 0; c < line.size(); c++) {
-        if (line[c] == ' ' && (c + 1 == line.size() || line[c+1] == ' ')) {
-            line.erase(c--, 1);
+// positions of the set bits of each byte (padded with 0s), for compacting
+// 8 bytes with a shuffle
+static constexpr std::array <uint64_t, 256> _compact_indices() {
+    std::array <uint64_t, 256> out = {};
+    for (size_t mask = 0; mask < 256; mask++) {
+        size_t count = 0;
+        for (uint64_t bit = 0; bit < 8; bit++) {
+            if (mask & (1 << bit)) {out[mask] |= bit << (8 * count++);}
         }
     }
+    return out;
+}
+static constexpr std::array <uint64_t, 256> _compact = _compact_indices();
+
+// classify 16 bytes with two table lookups (one per nibble): bit 0 is set
+// for digits, and bits 1 and 2 for letters
+__attribute__((target("sse4.2")))
+static inline __m128i _classify(const __m128i& bytes) {
+    const __m128i low_table = _mm_setr_epi8(5, 7, 7, 7, 7, 7, 7, 7, 7, 7, 6, 2, 2, 2, 2, 2);
+    const __m128i high_table = _mm_setr_epi8(0, 0, 0, 1, 2, 4, 2, 4, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    __m128i low = _mm_shuffle_epi8(low_table, _mm_and_si128(bytes, nibble));
+    __m128i high = _mm_shuffle_epi8(high_table, _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble));
+    return _mm_and_si128(low, high);
+}
+
+// write the bytes of `values` selected by `mask` (16 bits) to `out`,
+// returning the number written (writes up to 16 bytes past them)
+__attribute__((target("sse4.2,popcnt")))
+static inline size_t _compact16(const __m128i& values, const uint32_t& mask, char* out) {
+    const __m128i eight = _mm_set1_epi8(8);
+    __m128i low = _mm_loadl_epi64((const __m128i*)&_compact[mask & 0xFF]);
+    __m128i high = _mm_add_epi8(_mm_loadl_epi64((const __m128i*)&_compact[mask >> 8]), eight);
+    size_t num_low = _mm_popcnt_u32(mask & 0xFF);
+    _mm_storel_epi64((__m128i*)out, _mm_shuffle_epi8(values, low));
+    _mm_storel_epi64((__m128i*)(out + num_low), _mm_shuffle_epi8(values, high));
+    return num_low + _mm_popcnt_u32(mask >> 8);
+}
+
+// output bytes (lowercased letters and digits, and spaces for separators),
+// from bytes and their classes
+__attribute__((target("sse4.2")))
+static inline __m128i _format_values(const __m128i& bytes, const __m128i& classes) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i letter = _mm_cmpeq_epi8(_mm_cmpeq_epi8(_mm_and_si128(classes, _mm_set1_epi8(6)), zero), zero);
+    __m128i alnum = _mm_cmpeq_epi8(_mm_cmpeq_epi8(classes, zero), zero);
+    __m128i lowered = _mm_or_si128(bytes, _mm_and_si128(letter, _mm_set1_epi8(0x20)));
+    return _mm_blendv_epi8(_mm_set1_epi8(' '), lowered, alnum);
+}
 
-    // Send to lowercase
-    for (size_t c = 0; c < line.size(); c++) {
-        if (!isalpha(line[c])) {continue;}
-        line[c] = tolower(line[c]);
+// the SIMD kernels keep every letter and digit, and each separator that
+// follows one, so blocks can be compacted with shuffles. Blocks where a
+// letter meets a digit need a space inserted, and go through the scalar
+// kernel instead.
+__attribute__((target("sse4.2,popcnt")))
+static size_t _format_sse42(const char* line, const size_t& size, char* out, uint8_t& last) {
+    size_t written = 0, c = 0;
+    for (; c + 16 <= size; c += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(line + c));
+        __m128i classes = _classify(bytes);
+        const __m128i zero = _mm_setzero_si128();
+        uint32_t digits = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(classes, _mm_set1_epi8(1)), _mm_set1_epi8(1)));
+        uint32_t letters = 0xFFFF & ~_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(classes, _mm_set1_epi8(6)), zero));
+
+        // check for letters next to digits
+        uint32_t prev_digits = (digits << 1 | (last == 2)) & 0xFFFF;
+        uint32_t prev_letters = (letters << 1 | (last == 1)) & 0xFFFF;
+        if ((letters & prev_digits) | (digits & prev_letters)) {
+            written += _format_scalar(line + c, 16, out + written, last);
+            continue;
+        }
+
+        // keep letters and digits, and separators after them
+        written += _compact16(_format_values(bytes, classes), letters | digits | prev_letters | prev_digits, out + written);
+        last = letters >> 15? 1: digits >> 15? 2: 0;
     }
+    return written + _format_scalar(line + c, size - c, out + written, last);
+}
 
-    // Separate characters from numbers
-    for (size_t c = 0; c + 1 < line.size(); c++) {
-        size_t cur_score  = !!isalpha(line[c  ]) + 2 * !!isdigit(line[c  ]);
-        size_t next_score = !!isalpha(line[c+1]) + 2 * !!isdigit(line[c+1]);
-        if (cur_score + next_score != 3) {continue;}
-        line.insert(c+1, " ");
+__attribute__((target("avx2,popcnt")))
+static size_t _format_avx2(const char* line, const size_t& size, char* out, uint8_t& last) {
+    size_t written = 0, c = 0;
+    for (; c + 32 <= size; c += 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i*)(line + c));
+
+        // classify (with the nibble tables in both lanes)
+        const __m256i low_table = _mm256_setr_epi8(
+            5, 7, 7, 7, 7, 7, 7, 7, 7, 7, 6, 2, 2, 2, 2, 2,
+            5, 7, 7, 7, 7, 7, 7, 7, 7, 7, 6, 2, 2, 2, 2, 2
+        );
+        const __m256i high_table = _mm256_setr_epi8(
+            0, 0, 0, 1, 2, 4, 2, 4, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, 0, 1, 2, 4, 2, 4, 0, 0, 0, 0, 0, 0, 0, 0
+        );
+        const __m256i nibble = _mm256_set1_epi8(0x0F);
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i classes = _mm256_and_si256(
+            _mm256_shuffle_epi8(low_table, _mm256_and_si256(bytes, nibble)),
+            _mm256_shuffle_epi8(high_table, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble))
+        );
+        __m256i is_digit = _mm256_cmpeq_epi8(_mm256_and_si256(classes, _mm256_set1_epi8(1)), _mm256_set1_epi8(1));
+        __m256i not_letter = _mm256_cmpeq_epi8(_mm256_and_si256(classes, _mm256_set1_epi8(6)), zero);
+        uint32_t digits = _mm256_movemask_epi8(is_digit);
+        uint32_t letters = ~(uint32_t)_mm256_movemask_epi8(not_letter);
+
+        // check for letters next to digits
+        uint32_t prev_digits = digits << 1 | (last == 2);
+        uint32_t prev_letters = letters << 1 | (last == 1);
+        if ((letters & prev_digits) | (digits & prev_letters)) {
+            written += _format_scalar(line + c, 32, out + written, last);
+            continue;
+        }
+
+        // lowercase letters, and send separators to spaces
+        __m256i lowered = _mm256_or_si256(bytes, _mm256_andnot_si256(not_letter, _mm256_set1_epi8(0x20)));
+        __m256i alnum = _mm256_cmpeq_epi8(_mm256_cmpeq_epi8(classes, zero), zero);
+        __m256i values = _mm256_blendv_epi8(_mm256_set1_epi8(' '), lowered, alnum);
+
+        // keep letters and digits, and separators after them
+        uint32_t keep = letters | digits | prev_letters | prev_digits;
+        written += _compact16(_mm256_castsi256_si128(values), keep & 0xFFFF, out + written);
+        written += _compact16(_mm256_extracti128_si256(values, 1), keep >> 16, out + written);
+        last = letters >> 31? 1: digits >> 31? 2: 0;
     }
+    return written + _format_sse42(line + c, size - c, out + written, last);
+}
+
+text::Simd text::simd_support() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {return Simd::avx2;}
+    if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt")) {return Simd::sse42;}
+    return Simd::none;
+}
+
+#else
 
-    // Remove surrounding whitespace
-    {
-        size_t start = 0, finish = line.size();
-        while (start < line.size() && line[start] == ' ') {start++;}
-        while ((int)finish >= 0 && line[finish-1] == ' ') {finish--;}
-        line = line.substr(start, finish - start + 1);
+text::Simd text::simd_support() {
+    return Simd::none;
+}
+
+#endif
+
+string text::format(string line) {
+    string out;
+    format(line, out);
+    return out;
+}
+
+void text::format(const string_view& line, string& out) {
+    static const Simd simd = simd_support();
+    format(line, out, simd);
+}
+
+void text::format(const string_view& line, string& out, const Simd& simd_) {
+    static const Simd supported = simd_support();
+    Simd simd = simd_ < supported? simd_: supported;
+
+    // format in blocks (so the buffer only needs room for a block's spaces,
+    // rather than for doubling the line), growing but never shrinking it
+    size_t block = 1 << 16;
+    size_t written = 0;
+    uint8_t last = 0;
+    for (size_t start = 0; start < line.size(); start += block) {
+        size_t size = std::min(block, line.size() - start);
+        size_t room = std::max(written + 2 * size + 64, line.size() + 64);
+        if (out.size() < room) {out.resize(room);}
+        const char* in = line.data() + start;
+        char* dest = &out[written];
+        switch (simd) {
+#if defined(__x86_64__) || defined(__i386__)
+            case Simd::avx2: written += _format_avx2(in, size, dest, last); break;
+            case Simd::sse42: written += _format_sse42(in, size, dest, last); break;
+#endif
+            default: written += _format_scalar(in, size, dest, last);
+        }
     }
 
-    // Return result
-    return line;
+    // remove trailing space
+    if (written && out[written - 1] == ' ') {written--;}
+    out.resize(written);
 }
 
 vector <string> text::get_words(const string& line) {
@@ -84,3 +266,40 @@ vector <string> text::get_phrases(const string& line, const size_t& phrase_len)
     // Return result
     return phrases;
 }
+
+text::Phrases::Phrases(const size_t& smallest, const size_t& largest):
+    _smallest(smallest? smallest: 1),
+    _largest(largest) {
+    _starts.push_back(1);
+}
+
+void text::Phrases::parse(const string_view& line) {
+
+    // Format line
+    format(line, _line);
+
+    // Find start of each word
+    _starts.clear();
+    if (!_line.empty()) {
+        _starts.push_back(0);
+        for (size_t c = 0; c < _line.size(); c++) {
+            if (_line[c] == ' ') {_starts.push_back(c + 1);}
+        }
+    }
+
+    // Add sentinel (as if there were a space after the last word)
+    _starts.push_back(_line.size() + 1);
+}
+
+string_view text::Phrases::word(const size_t& word_num) const {
+    size_t start = _starts[word_num];
+    return string_view(&_line[start], _starts[word_num + 1] - 1 - start);
+}
+
+size_t text::Phrases::num_phrases() const {
+    size_t out = 0;
+    for (size_t len = _smallest; len <= _largest && len <= num_words(); len++) {
+        out += num_words() - len + 1;
+    }
+    return out;
+}
@@ -2,9 +2,11 @@
 #define UTILS_TEXT_H
 
 #include <string>
+#include <string_view>
 #include <vector>
 
 using std::string;
+using std::string_view;
 using std::vector;
 
 
@@ -21,6 +23,10 @@ namespace utils {
         #. adds spaces between adjacent characters and numbers
         #. removes surrounding whitespace
 
+        All of this happens in one linear pass, using SSE4.2 or AVX2 if the
+        CPU supports them (see simd_support()). Only ASCII letters and digits
+        are kept.
+
         Parameters
         ----------
         line: const string&
@@ -32,6 +38,48 @@ namespace utils {
             formatted line
          */
         string format(string line);
+
+        /* apply standard formatting to line, writing into a buffer
+
+        Identical to text::format(), but reuses the capacity of `out`, so that
+        repeatedly formatting documents into the same buffer doesn't allocate.
+
+        Parameters
+        ----------
+        line: const string_view&
+            line to format
+        out: string&
+            buffer to hold formatted line
+         */
+        void format(const string_view& line, string& out);
+
+        /* instruction sets text::format() can use */
+        enum class Simd {none, sse42, avx2};
+
+        /* best instruction set text::format() can use on this CPU
+
+        Returns
+        -------
+        Simd
+            instruction set, detected at runtime (Simd::none if not x86)
+         */
+        Simd simd_support();
+
+        /* apply standard formatting to line, using the given instruction set
+
+        Identical to text::format() (which uses simd_support()), for testing
+        and benchmarking each kernel.
+
+        Parameters
+        ----------
+        line: const string_view&
+            line to format
+        out: string&
+            buffer to hold formatted line
+        simd: const Simd&
+            instruction set to use (if supported, otherwise the best that is)
+         */
+        void format(const string_view& line, string& out, const Simd& simd);
         
         /* break line into words
 
@@ -69,6 +117,100 @@ namespace utils {
             const string& line,
             const size_t& phrase_len
         );
+
+        /* streaming n-gram generator
+
+        Formats a line once, and then yields every phrase from `smallest` to
+        `largest` words long as a view into the formatted line. (Because
+        formatted words are separated by single spaces, each phrase is a
+        contiguous substring of the formatted line.)
+
+        Buffers are kept between calls to parse(), so reusing one generator
+        for many documents doesn't allocate once its buffers have grown.
+         */
+        class Phrases {
+            public:
+
+                /* Constructor
+
+                Parameters
+                ----------
+                smallest: const size_t&
+                    smallest phrase length (in words)
+                largest: const size_t&
+                    largest phrase length (in words)
+                 */
+                Phrases(const size_t& smallest, const size_t& largest);
+
+                /* Format line, and find its words
+
+                Parameters
+                ----------
+                line: const string_view&
+                    line to process
+                 */
+                void parse(const string_view& line);
+
+                /* Call `func(phrase)` for each phrase in the parsed line
+
+                Phrases are yielded word by word: all phrases starting at the
+                first word (shortest first), then all starting at the second,
+                and so on. Each phrase is a string_view, valid until the next
+                call to parse().
+
+                Parameters
+                ----------
+                func: F&&
+                    callable taking a `const string_view&`
+                 */
+                template <class F>
+                void for_each(F&& func) const;
+
+                /* Number of words in parsed line
+                
+                Returns
+                -------
+                size_t
+                    number of words
+                 */
+                size_t num_words() const {return _starts.size() - 1;}
+
+                /* Get word from parsed line
+
+                Parameters
+                ----------
+                word_num: const size_t&
+                    word to get
+
+                Returns
+                -------
+                string_view
+                    requested word
+                 */
+                string_view word(const size_t& word_num) const;
+
+                /* Number of phrases in parsed line
+                
+                Returns
+                -------
+                size_t
+                    number of phrases for_each() will yield
+                 */
+                size_t num_phrases() const;
+
+            private:
+
+                // phrase lengths
+                size_t _smallest;
+                size_t _largest;
+
+                // formatted line
+                string _line;
+
+                // start of each word in _line, plus one past the end of _line
+                vector <size_t> _starts;
+        };
     }
 }
+#include <utils/text.hxx>
 #endif
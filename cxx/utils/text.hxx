@@ -0,0 +1,15 @@
+#ifdef UTILS_TEXT_H
+
+template <class F>
+void utils::text::Phrases::for_each(F&& func) const {
+    size_t num_words_ = num_words();
+    for (size_t first = 0; first < num_words_; first++) {
+        for (size_t len = _smallest; len <= _largest && first + len <= num_words_; len++) {
+            size_t start = _starts[first];
+            size_t finish = _starts[first + len] - 1;
+            func(string_view(&_line[start], finish - start));
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,603 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include <utils/manip.h>
+#include <utils/parallel.h>
+#include <utils/quant.h>
+#include <vhash/index.h>
+
+using namespace utils;
+using namespace vhash;
+
+
+VHashIndex::VHashIndex(
+    const VHash& model,
+    const string& quantize,
+    const int& n_jobs
+):
+    _model(model),
+    _n_jobs(n_jobs),
+    _dimension(model.num_features()) {
+
+    // parse quantization
+    if (quantize != "none" && quantize != "int8") {
+        throw std::invalid_argument(
+            "quantize must be 'none' or 'int8' (got '" + quantize + "')"
+        );
+    }
+    _int8 = quantize == "int8";
+
+    // check number of threads (throwing if 0)
+    parallel::num_threads(n_jobs);
+}
+
+void VHashIndex::add(const vector <string>& docs) {
+    vector <float> vectors(docs.size() * _dimension);
+    _model.transform(docs, vectors.data(), _dimension);
+    add_vectors(vectors.data(), docs.size());
+}
+
+void VHashIndex::add_vectors(const float* vectors, const size_t& num_vectors) {
+    std::unique_lock <std::shared_mutex> guard(_lock);
+
+    // store vectors
+    if (!_int8) {
+        _vectors.insert(_vectors.end(), vectors, vectors + num_vectors * _dimension);
+    }
+    else {
+        for (size_t v = 0; v < num_vectors; v++) {
+            const float* values = vectors + v * _dimension;
+            float scale = quant::int8_scale(values, _dimension);
+            for (size_t i = 0; i < _dimension; i++) {
+                _vectors_int8.push_back(quant::to_int8(values[i], scale));
+            }
+            _scales.push_back(scale);
+        }
+    }
+
+    // add to lists (if built)
+    if (!_lists.empty()) {
+        for (size_t v = 0; v < num_vectors; v++) {
+            _lists[_closest(vectors + v * _dimension)].push_back(_size + v);
+        }
+    }
+    _size += num_vectors;
+}
+
+void VHashIndex::build(const size_t& num_lists_, const size_t& iterations) {
+    std::unique_lock <std::shared_mutex> guard(_lock);
+
+    // clear lists
+    size_t num_lists = std::min(num_lists_, _size);
+    _centroids.clear();
+    _lists.clear();
+    if (!num_lists) {return;}
+
+    // start from randomly chosen vectors
+    _centroids.resize(num_lists * _dimension);
+    vector <char> chosen = manip::rand_select(_size, num_lists);
+    for (size_t id = 0, c = 0; id < _size; id++) {
+        if (chosen[id]) {_get_vector(id, &_centroids[_dimension * c++]);}
+    }
+
+    // refine centroids (spherical k-means): assign each vector to its closest
+    // centroid, then move each centroid to the direction of its vectors' mean
+    size_t num_threads = parallel::num_threads(_n_jobs);
+    size_t block = 1024;
+    vector <uint32_t> assignment(_size);
+    vector <vector <float>> scratch(num_threads, vector <float>(_dimension));
+    for (size_t iteration = 0; iteration <= iterations; iteration++) {
+
+        // normalize centroids
+        for (size_t c = 0; c < num_lists; c++) {
+            float* centroid = &_centroids[c * _dimension];
+            float norm = std::sqrt(_dot(centroid, centroid, _dimension));
+            if (!norm) {continue;}
+            for (size_t i = 0; i < _dimension; i++) {
+                centroid[i] /= norm;
+            }
+        }
+
+        // assign
+        parallel::for_each((_size + block - 1) / block, num_threads, [&](const size_t& task, const size_t& thread) {
+            for (size_t id = task * block; id < std::min(_size, (task + 1) * block); id++) {
+                _get_vector(id, scratch[thread].data());
+                assignment[id] = _closest(scratch[thread].data());
+            }
+        });
+        if (iteration == iterations) {break;}
+
+        // sum vectors of each centroid (keeping centroids with no vectors)
+        vector <float> sums(num_lists * _dimension, 0);
+        vector <size_t> counts(num_lists, 0);
+        float* values = scratch[0].data();
+        for (size_t id = 0; id < _size; id++) {
+            _get_vector(id, values);
+            float* sum = &sums[assignment[id] * _dimension];
+            for (size_t i = 0; i < _dimension; i++) {
+                sum[i] += values[i];
+            }
+            counts[assignment[id]]++;
+        }
+        for (size_t c = 0; c < num_lists; c++) {
+            if (!counts[c]) {continue;}
+            std::copy(&sums[c * _dimension], &sums[(c + 1) * _dimension], &_centroids[c * _dimension]);
+        }
+    }
+
+    // fill lists
+    _lists.resize(num_lists);
+    for (size_t id = 0; id < _size; id++) {
+        _lists[assignment[id]].push_back(id);
+    }
+}
+
+std::pair <vector <vector <size_t>>, vector <vector <float>>> VHashIndex::query(
+    const vector <string>& docs,
+    const size_t& k_,
+    const size_t& num_probes
+) {
+    // transform docs
+    vector <float> vectors(docs.size() * _dimension);
+    _model.transform(docs, vectors.data(), _dimension);
+
+    // query
+    size_t k = std::min(k_, size());
+    vector <int64_t> ids(docs.size() * k);
+    vector <float> scores(docs.size() * k);
+    query_vectors(vectors.data(), docs.size(), k, num_probes, ids.data(), scores.data());
+
+    // drop padding
+    std::pair <vector <vector <size_t>>, vector <vector <float>>> out;
+    out.first.resize(docs.size());
+    out.second.resize(docs.size());
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+        for (size_t r = 0; r < k && ids[doc_num * k + r] >= 0; r++) {
+            out.first[doc_num].push_back(ids[doc_num * k + r]);
+            out.second[doc_num].push_back(scores[doc_num * k + r]);
+        }
+    }
+    return out;
+}
+
+void VHashIndex::query_vectors(
+    const float* vectors,
+    const size_t& num_vectors,
+    const size_t& k,
+    const size_t& num_probes,
+    int64_t* ids,
+    float* scores
+) const {
+    if (!k) {return;}
+    std::shared_lock <std::shared_mutex> guard(_lock);
+
+    // search every stored vector, unless probing some lists
+    bool probe = num_probes && num_probes < _lists.size();
+
+    // best results are kept in a heap, with the worst on top (ties going to
+    // the lowest id)
+    typedef std::pair <float, int64_t> Result;
+    auto better = [](const Result& a, const Result& b) {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    };
+    auto offer = [&](vector <Result>& heap, const Result& result) {
+        if (heap.size() < k) {
+            heap.push_back(result);
+            std::push_heap(heap.begin(), heap.end(), better);
+        }
+        else if (better(result, heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), better);
+            heap.back() = result;
+            std::push_heap(heap.begin(), heap.end(), better);
+        }
+    };
+
+    // queries are searched in tiles, so each stored vector is read from
+    // memory once per tile (rather than once per query)
+    size_t tile = probe? 1: 8;
+    size_t num_tiles = (num_vectors + tile - 1) / tile;
+    size_t num_threads = parallel::num_threads(_n_jobs);
+    parallel::for_each(num_tiles, num_threads, [&](const size_t& t, const size_t&) {
+        size_t first = t * tile;
+        size_t last = std::min(num_vectors, first + tile);
+
+        // quantize queries (if storing int8)
+        vector <int8_t> queries_int8(_int8? (last - first) * _dimension: 0);
+        vector <float> query_scales(last - first, 1);
+        for (size_t q = first; _int8 && q < last; q++) {
+            const float* query = vectors + q * _dimension;
+            query_scales[q - first] = quant::int8_scale(query, _dimension);
+            for (size_t i = 0; i < _dimension; i++) {
+                queries_int8[(q - first) * _dimension + i] = quant::to_int8(query[i], query_scales[q - first]);
+            }
+        }
+
+        // get candidates
+        vector <uint32_t> candidates;
+        if (probe) {
+
+            // rank centroids
+            const float* query = vectors + first * _dimension;
+            vector <std::pair <float, size_t>> ranked(_lists.size());
+            for (size_t c = 0; c < _lists.size(); c++) {
+                ranked[c] = {-_dot(query, &_centroids[c * _dimension], _dimension), c};
+            }
+            std::partial_sort(ranked.begin(), ranked.begin() + num_probes, ranked.end());
+
+            // take their lists
+            for (size_t p = 0; p < num_probes; p++) {
+                const vector <uint32_t>& list = _lists[ranked[p].second];
+                candidates.insert(candidates.end(), list.begin(), list.end());
+            }
+        }
+
+        // score candidates (or every stored vector)
+        vector <vector <Result>> heaps(last - first);
+        size_t num_candidates = probe? candidates.size(): _size;
+        for (size_t g = 0; g < num_candidates; g++) {
+            size_t id = probe? candidates[g]: g;
+            for (size_t q = first; q < last; q++) {
+                const int8_t* query_int8 = _int8? &queries_int8[(q - first) * _dimension]: nullptr;
+                float score = _score(id, vectors + q * _dimension, query_int8, query_scales[q - first]);
+                offer(heaps[q - first], Result(score, id));
+            }
+        }
+
+        // write results, from best to worst
+        for (size_t q = first; q < last; q++) {
+            vector <Result>& heap = heaps[q - first];
+            std::sort_heap(heap.begin(), heap.end(), better);
+            for (size_t r = 0; r < k; r++) {
+                bool found = r < heap.size();
+                ids[q * k + r] = found? heap[r].second: -1;
+                scores[q * k + r] = found? heap[r].first: -std::numeric_limits <float>::infinity();
+            }
+        }
+    });
+}
+
+size_t VHashIndex::size() const {
+    std::shared_lock <std::shared_mutex> guard(_lock);
+    return _size;
+}
+
+size_t VHashIndex::num_lists() const {
+    std::shared_lock <std::shared_mutex> guard(_lock);
+    return _lists.size();
+}
+
+size_t VHashIndex::memory() const {
+    std::shared_lock <std::shared_mutex> guard(_lock);
+    size_t out = _vectors.capacity() * sizeof(float);
+    out += _vectors_int8.capacity() * sizeof(int8_t);
+    out += _scales.capacity() * sizeof(float);
+    out += _centroids.capacity() * sizeof(float);
+    for (const vector <uint32_t>& list: _lists) {
+        out += sizeof(list) + list.capacity() * sizeof(uint32_t);
+    }
+    return out;
+}
+
+#ifndef __CXX_TESTING__
+void VHashIndex::add_numpy(const py::array_t <float, py::array::c_style | py::array::forcecast>& vectors) {
+    if (vectors.ndim() != 2 || (size_t)vectors.shape(1) != _dimension) {
+        throw py::value_error("vectors must have shape (num_vectors, " + std::to_string(_dimension) + ")");
+    }
+    add_vectors(vectors.data(), vectors.shape(0));
+}
+
+py::tuple VHashIndex::query_numpy(
+    const vector <string>& docs,
+    const size_t& k_,
+    const size_t& num_probes
+) {
+    // size outputs
+    size_t k = std::min(k_, size());
+    py::array_t <int64_t> ids({docs.size(), k});
+    py::array_t <float> scores({docs.size(), k});
+    int64_t* ids_data = ids.mutable_data();
+    float* scores_data = scores.mutable_data();
+
+    // transform and search (releasing the GIL, so other Python threads can run)
+    {
+        py::gil_scoped_release release;
+        vector <float> vectors(docs.size() * _dimension);
+        _model.transform(docs, vectors.data(), _dimension);
+        query_vectors(vectors.data(), docs.size(), k, num_probes, ids_data, scores_data);
+    }
+    return py::make_tuple(ids, scores);
+}
+
+py::tuple VHashIndex::query_vectors_numpy(
+    const py::array_t <float, py::array::c_style | py::array::forcecast>& vectors,
+    const size_t& k_,
+    const size_t& num_probes
+) const {
+    if (vectors.ndim() != 2 || (size_t)vectors.shape(1) != _dimension) {
+        throw py::value_error("vectors must have shape (num_vectors, " + std::to_string(_dimension) + ")");
+    }
+
+    // copy queries (which other Python threads could modify), and size outputs
+    size_t num_vectors = vectors.shape(0);
+    vector <float> queries(vectors.data(), vectors.data() + num_vectors * _dimension);
+    size_t k = std::min(k_, size());
+    py::array_t <int64_t> ids({num_vectors, k});
+    py::array_t <float> scores({num_vectors, k});
+    int64_t* ids_data = ids.mutable_data();
+    float* scores_data = scores.mutable_data();
+
+    // search (releasing the GIL)
+    {
+        py::gil_scoped_release release;
+        query_vectors(queries.data(), num_vectors, k, num_probes, ids_data, scores_data);
+    }
+    return py::make_tuple(ids, scores);
+}
+#endif
+
+float VHashIndex::_score(
+    const size_t& id,
+    const float* query,
+    const int8_t* query_int8,
+    const float& query_scale
+) const {
+    if (!_int8) {return _dot(query, &_vectors[id * _dimension], _dimension);}
+    return _dot(query_int8, &_vectors_int8[id * _dimension], _dimension) * query_scale * _scales[id];
+}
+
+void VHashIndex::_get_vector(const size_t& id, float* out) const {
+    if (!_int8) {
+        std::copy(&_vectors[id * _dimension], &_vectors[(id + 1) * _dimension], out);
+        return;
+    }
+    for (size_t i = 0; i < _dimension; i++) {
+        out[i] = _vectors_int8[id * _dimension + i] * _scales[id];
+    }
+}
+
+size_t VHashIndex::_closest(const float* values) const {
+    size_t out = 0;
+    float best = -std::numeric_limits <float>::infinity();
+    for (size_t c = 0; c < _centroids.size() / _dimension; c++) {
+        float score = _dot(values, &_centroids[c * _dimension], _dimension);
+        if (score > best) {
+            best = score;
+            out = c;
+        }
+    }
+    return out;
+}
+
+float VHashIndex::_dot(const float* a, const float* b, const size_t& size) {
+
+    // independent partial sums, so the compiler can keep them in one vector
+    // register (floats can't be reordered into one without -ffast-math)
+    float sums[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        for (size_t j = 0; j < 8; j++) {
+            sums[j] += a[i + j] * b[i + j];
+        }
+    }
+    for (; i < size; i++) {
+        sums[0] += a[i] * b[i];
+    }
+    return ((sums[0] + sums[1]) + (sums[2] + sums[3])) + ((sums[4] + sums[5]) + (sums[6] + sums[7]));
+}
+
+int32_t VHashIndex::_dot(const int8_t* a, const int8_t* b, const size_t& size) {
+    int32_t out = 0;
+    for (size_t i = 0; i < size; i++) {
+        out += (int32_t)a[i] * b[i];
+    }
+    return out;
+}
+
+void VHashIndex::_test() {
+    _test_brute_force();
+    _test_int8();
+    _test_build();
+    _test_docs();
+    _test_concurrency();
+}
+
+// random vectors, for testing
+static vector <float> _random_vectors(const size_t& num_vectors, const size_t& dimension) {
+    vector <float> out(num_vectors * dimension);
+    for (float& value: out) {
+        value = manip::rand_index(2001) / 1000.f - 1;
+    }
+    return out;
+}
+
+// fitted model, for testing
+static VHash _test_model(const size_t& num_features) {
+    vector <string> docs;
+    vector <size_t> labels;
+    for (size_t doc_num = 0; doc_num < 200; doc_num++) {
+        string doc;
+        for (size_t word = 0; word < 20; word++) {
+            doc += "w" + std::to_string(manip::rand_index(50 + 50 * (doc_num % 2))) + " ";
+        }
+        docs.push_back(doc);
+        labels.push_back(doc_num % 2);
+    }
+    return VHash(2, 1E-3, num_features).fit(docs, labels);
+}
+
+void VHashIndex::_test_brute_force() {
+    size_t dimension = 19, num_stored = 500, num_queries = 13, k = 7;
+    VHashIndex index(_test_model(dimension), "none", 3);
+    assert(index.dimension() == dimension);
+
+    // store vectors (in two batches)
+    vector <float> stored = _random_vectors(num_stored, dimension);
+    index.add_vectors(stored.data(), 200);
+    index.add_vectors(&stored[200 * dimension], num_stored - 200);
+    assert(index.size() == num_stored);
+
+    // results are the top k, sorted
+    vector <float> queries = _random_vectors(num_queries, dimension);
+    vector <int64_t> ids(num_queries * k);
+    vector <float> scores(num_queries * k);
+    index.query_vectors(queries.data(), num_queries, k, 0, ids.data(), scores.data());
+    for (size_t q = 0; q < num_queries; q++) {
+        vector <float> expected(num_stored);
+        for (size_t id = 0; id < num_stored; id++) {
+            expected[id] = _dot(&queries[q * dimension], &stored[id * dimension], dimension);
+        }
+        vector <float> sorted = expected;
+        std::sort(sorted.rbegin(), sorted.rend());
+        for (size_t r = 0; r < k; r++) {
+            assert(scores[q * k + r] == sorted[r]);
+            assert(expected[ids[q * k + r]] == sorted[r]);
+        }
+    }
+
+    // k beyond the number of stored vectors pads results
+    VHashIndex small(_test_model(dimension));
+    small.add_vectors(stored.data(), 2);
+    small.query_vectors(queries.data(), 1, 3, 0, ids.data(), scores.data());
+    assert(ids[0] >= 0 && ids[1] >= 0 && ids[2] == -1);
+    assert(std::isinf(scores[2]));
+}
+
+void VHashIndex::_test_int8() {
+    size_t dimension = 32, num_stored = 300, num_queries = 10, k = 5;
+    vector <float> stored = _random_vectors(num_stored, dimension);
+    vector <float> queries = _random_vectors(num_queries, dimension);
+
+    // unknown quantization (or zero jobs) throws
+    for (const auto& [quantize, n_jobs]: vector <std::pair <string, int>>{{"fp16", 1}, {"none", 0}}) {
+        bool thrown = false;
+        try {
+            VHashIndex(_test_model(dimension), quantize, n_jobs);
+        } catch (const std::invalid_argument&) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+
+    // int8 scores are close to float scores, in a quarter of the memory
+    VHashIndex exact(_test_model(dimension)), quantized(_test_model(dimension), "int8");
+    exact.add_vectors(stored.data(), num_stored);
+    quantized.add_vectors(stored.data(), num_stored);
+    assert(quantized.memory() < exact.memory() / 2);
+    vector <int64_t> ids(num_queries * k), exact_ids(num_queries * k);
+    vector <float> scores(num_queries * k), exact_scores(num_queries * k);
+    quantized.query_vectors(queries.data(), num_queries, k, 0, ids.data(), scores.data());
+    exact.query_vectors(queries.data(), num_queries, k, 0, exact_ids.data(), exact_scores.data());
+    for (size_t r = 0; r < num_queries * k; r++) {
+        float score = _dot(&queries[(r / k) * dimension], &stored[ids[r] * dimension], dimension);
+        assert(std::fabs(scores[r] - score) < 0.1);
+    }
+    for (size_t q = 0; q < num_queries; q++) {
+        assert(std::fabs(scores[q * k] - exact_scores[q * k]) < 0.2);
+    }
+}
+
+void VHashIndex::_test_build() {
+    size_t dimension = 16, num_stored = 2000, num_queries = 50, k = 10;
+    vector <float> stored = _random_vectors(num_stored, dimension);
+    vector <float> queries = _random_vectors(num_queries, dimension);
+    VHashIndex index(_test_model(dimension), "none", 2);
+    index.add_vectors(stored.data(), num_stored - 100);
+
+    // every vector is in exactly one list (including ones added after building)
+    index.build(20, 5);
+    index.add_vectors(&stored[(num_stored - 100) * dimension], 100);
+    assert(index.num_lists() == 20);
+    vector <char> listed(num_stored, false);
+    for (const vector <uint32_t>& list: index._lists) {
+        for (const uint32_t& id: list) {
+            assert(!listed[id]);
+            listed[id] = true;
+        }
+    }
+    assert(std::count(listed.begin(), listed.end(), true) == (long)num_stored);
+
+    // probing every list is exact
+    vector <int64_t> ids(num_queries * k), exact_ids(num_queries * k);
+    vector <float> scores(num_queries * k), exact_scores(num_queries * k);
+    index.query_vectors(queries.data(), num_queries, k, 0, exact_ids.data(), exact_scores.data());
+    index.query_vectors(queries.data(), num_queries, k, 20, ids.data(), scores.data());
+    assert(ids == exact_ids);
+
+    // probing some lists finds most of the top results
+    index.query_vectors(queries.data(), num_queries, k, 5, ids.data(), scores.data());
+    size_t found = 0;
+    for (size_t q = 0; q < num_queries; q++) {
+        for (size_t r = 0; r < k; r++) {
+            auto begin = exact_ids.begin() + q * k;
+            found += std::find(begin, begin + k, ids[q * k + r]) != begin + k;
+        }
+    }
+    assert(found > num_queries * k / 2);
+
+    // there are never more lists than vectors
+    VHashIndex small(_test_model(dimension));
+    small.add_vectors(stored.data(), 3);
+    small.build(10);
+    assert(small.num_lists() == 3);
+}
+
+void VHashIndex::_test_docs() {
+    vector <string> docs = {"w1 w2 w3 w4", "w5 w6 w7", "w1 w2 w3 w8", "w9 w10"};
+    VHash model = _test_model(50);
+    VHashIndex index(model);
+    index.add(docs);
+    assert(index.size() == docs.size());
+
+    // results match dot products of transformed docs
+    auto [ids, scores] = index.query(docs, 2);
+    vector <vector <float>> transformed = model.transform(docs);
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+        assert(ids[doc_num].size() == 2);
+        for (size_t r = 0; r < 2; r++) {
+            const vector <float>& result = transformed[ids[doc_num][r]];
+            float score = _dot(transformed[doc_num].data(), result.data(), model.num_features());
+            assert(std::fabs(scores[doc_num][r] - score) < 1E-5);
+        }
+        assert(scores[doc_num][0] >= scores[doc_num][1]);
+    }
+
+    // results are capped at the number of stored docs
+    assert(index.query(docs, 10).first[0].size() == docs.size());
+}
+
+void VHashIndex::_test_concurrency() {
+    size_t dimension = 11, batch = 10, num_batches = 200, k = 5;
+    VHashIndex index(_test_model(dimension), "int8", 2);
+    vector <float> stored = _random_vectors(batch * num_batches, dimension);
+    index.add_vectors(stored.data(), batch);
+    index.build(4, 2);
+
+    // add batches on one thread, while querying on another
+    std::thread adder([&]() {
+        for (size_t b = 1; b < num_batches; b++) {
+            index.add_vectors(&stored[b * batch * dimension], batch);
+            if (b % 50 == 0) {index.build(4, 2);}
+        }
+    });
+    vector <float> queries = _random_vectors(3, dimension);
+    vector <int64_t> ids(3 * k);
+    vector <float> scores(3 * k);
+    for (size_t round = 0; round < 200; round++) {
+        index.query_vectors(queries.data(), 3, k, round % 2 * 2, ids.data(), scores.data());
+        size_t size = index.size();
+        for (int64_t id: ids) {
+            assert(id >= -1 && id < (int64_t)size);
+        }
+    }
+    adder.join();
+
+    // every vector was added, and can be found
+    assert(index.size() == batch * num_batches);
+    index.query_vectors(stored.data(), 1, 1, 0, ids.data(), scores.data());
+    assert(ids[0] >= 0);
+}
@@ -0,0 +1,243 @@
+#ifndef VHASH_INDEX_H
+#define VHASH_INDEX_H
+
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <vhash/vhash.h>
+
+#ifndef __CXX_TESTING__
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+namespace py = pybind11;
+#endif
+
+using std::string;
+using std::vector;
+
+
+namespace vhash {
+
+    /* Index of transformed documents, for top-k similarity search
+
+    Stores the transformed vector of each added document in one contiguous
+    row-major array (as float, or as int8 with a scale for each row), and
+    finds the stored documents with the largest dot products with a query.
+
+    By default, queries compare against every stored document. After
+    build(), stored documents are also grouped into lists around centroids
+    (an inverted file index), and queries can instead search just the lists
+    whose centroids are closest to them (approximate search).
+
+    Methods are thread-safe: queries share a lock, while adding and building
+    take it exclusively (so Python can release the GIL while they run).
+    */
+    class VHashIndex {
+        public:
+
+            /* Constructor
+
+            Parameters
+            ----------
+            model: const VHash&
+                fitted model, used to transform documents
+            quantize: const string&
+                how to store vectors: "none" (float) or "int8"
+            n_jobs: const int&
+                number of threads to use (as for VHash)
+
+            Raises
+            ------
+            std::invalid_argument
+                if quantize is unknown, or n_jobs is 0
+             */
+            VHashIndex(
+                const VHash& model,
+                const string& quantize = "none",
+                const int& n_jobs = 1
+            );
+
+            /* Transform docs, and add them to the index
+
+            Documents are numbered in the order they're added.
+
+            Parameters
+            ----------
+            docs: const vector <string>&
+                documents to add
+             */
+            void add(const vector <string>& docs);
+
+            /* Add transformed vectors to the index
+
+            Parameters
+            ----------
+            vectors: const float*
+                row-major vectors, each with `dimension()` values
+            num_vectors: const size_t&
+                number of vectors
+             */
+            void add_vectors(const float* vectors, const size_t& num_vectors);
+
+            /* Group stored documents into lists, for approximate search
+
+            Runs spherical k-means over the stored vectors. Documents added
+            later are put into the list of their closest centroid.
+
+            Parameters
+            ----------
+            num_lists: const size_t&
+                number of lists (at most the number of stored documents)
+            iterations: const size_t&
+                number of k-means iterations
+             */
+            void build(const size_t& num_lists, const size_t& iterations = 10);
+
+            /* Find the stored documents most similar to each doc
+
+            Parameters
+            ----------
+            docs: const vector <string>&
+                documents to query
+            k: const size_t&
+                number of results per query (at most `size()`)
+            num_probes: const size_t&
+                number of lists to search (if built). If 0, or at least the
+                number of lists, every stored document is searched.
+
+            Returns
+            -------
+            std::pair <vector <vector <size_t>>, vector <vector <float>>>
+                for each doc, ids of the most similar stored documents, and
+                their dot products, from most to least similar (fewer than k,
+                if the searched lists hold fewer documents)
+             */
+            std::pair <vector <vector <size_t>>, vector <vector <float>>> query(
+                const vector <string>& docs,
+                const size_t& k,
+                const size_t& num_probes = 0
+            );
+
+            /* Find the stored documents most similar to each vector
+
+            Parameters
+            ----------
+            vectors: const float*
+                row-major query vectors, each with `dimension()` values
+            num_vectors: const size_t&
+                number of query vectors
+            k: const size_t&
+                number of results per query (at most `size()`)
+            num_probes: const size_t&
+                number of lists to search (as in query())
+            ids: int64_t*
+                output: `k` ids for each query (padded with -1)
+            scores: float*
+                output: `k` dot products for each query (padded with -inf)
+             */
+            void query_vectors(
+                const float* vectors,
+                const size_t& num_vectors,
+                const size_t& k,
+                const size_t& num_probes,
+                int64_t* ids,
+                float* scores
+            ) const;
+
+            // ===============================================================
+            // Meta-data
+
+            /* Number of stored documents */
+            size_t size() const;
+
+            /* Dimension of stored vectors (number of features of the model) */
+            size_t dimension() const {return _dimension;}
+
+            /* Number of lists (0 if not built) */
+            size_t num_lists() const;
+
+            /* Memory used by stored vectors and lists, in bytes */
+            size_t memory() const;
+
+            // numpy support
+            #ifndef __CXX_TESTING__
+            void add_numpy(const py::array_t <float, py::array::c_style | py::array::forcecast>& vectors);
+            py::tuple query_numpy(
+                const vector <string>& docs,
+                const size_t& k,
+                const size_t& num_probes
+            );
+            py::tuple query_vectors_numpy(
+                const py::array_t <float, py::array::c_style | py::array::forcecast>& vectors,
+                const size_t& k,
+                const size_t& num_probes
+            ) const;
+            #endif
+
+            // tests
+            static void _test();
+
+        private:
+
+            // shared by queries, and held exclusively while stored vectors or
+            // lists change
+            mutable std::shared_mutex _lock;
+
+            // model, for transforming documents
+            VHash _model;
+
+            // whether vectors are stored as int8
+            bool _int8;
+
+            // number of threads
+            int _n_jobs;
+
+            // number of values in each vector
+            size_t _dimension;
+
+            // number of stored vectors
+            size_t _size = 0;
+
+            // stored vectors (row-major, as float or int8), and the scale of
+            // each int8 row
+            vector <float> _vectors;
+            vector <int8_t> _vectors_int8;
+            vector <float> _scales;
+
+            // unit-length centroids (row-major), and ids in each centroid's list
+            vector <float> _centroids;
+            vector <vector <uint32_t>> _lists;
+
+            // score of stored vector `id`, against a query (and, if storing
+            // int8, the query quantized, with its scale)
+            float _score(
+                const size_t& id,
+                const float* query,
+                const int8_t* query_int8,
+                const float& query_scale
+            ) const;
+
+            // get vector of stored vector `id` (as float)
+            void _get_vector(const size_t& id, float* out) const;
+
+            // get closest centroid to values
+            size_t _closest(const float* values) const;
+
+            // dot product of float vectors
+            static float _dot(const float* a, const float* b, const size_t& size);
+
+            // dot product of int8 vectors
+            static int32_t _dot(const int8_t* a, const int8_t* b, const size_t& size);
+
+            // tests
+            static void _test_brute_force();
+            static void _test_int8();
+            static void _test_build();
+            static void _test_docs();
+            static void _test_concurrency();
+    };
+}
+#endif
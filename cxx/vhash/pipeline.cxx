@@ -0,0 +1,321 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include <utils/manip.h>
+#include <utils/queue.h>
+#include <vhash/pipeline.h>
+
+using namespace utils;
+using namespace vhash;
+
+
+VHashPipeline::VHashPipeline(
+    const VHash& model,
+    const size_t& batch_size,
+    const size_t& num_batches
+):
+    _model(model),
+    _batch_size(batch_size),
+    _num_batches(num_batches) {
+
+    // check parameters
+    if (!batch_size) {
+        throw std::invalid_argument("batch_size must be at least 1");
+    }
+    if (num_batches < 3) {
+        throw std::invalid_argument(
+            "num_batches must be at least 3 (got " + std::to_string(num_batches) + ")"
+        );
+    }
+}
+
+void VHashPipeline::transform(
+    const vector <string>& docs,
+    float* out,
+    const size_t& row_stride
+) {
+    using clock = std::chrono::steady_clock;
+    auto since = [](const clock::time_point& start) {
+        return std::chrono::duration <double>(clock::now() - start).count();
+    };
+    clock::time_point start = clock::now();
+
+    // reusable buffers for a batch of documents [front, back)
+    struct Batch {
+        size_t front = 0;
+        size_t back = 0;
+        vector <VHash::Tokenizer> tokenizers;
+        vector <Sparse> weighted;
+    };
+    size_t batch_size = std::min(_batch_size, std::max(docs.size(), (size_t)1));
+    size_t num_batches = std::min(_num_batches, (docs.size() + batch_size - 1) / batch_size);
+    vector <Batch> batches(num_batches);
+
+    // queues between stages (each holds every batch, so only the free
+    // batches limit how far ahead the first stage can get)
+    SpscQueue <Batch*> free_batches(_num_batches), tokenized(_num_batches), weighed(_num_batches);
+    for (Batch& batch: batches) {
+        batch.tokenizers.assign(batch_size, VHash::Tokenizer(_model));
+        batch.weighted.resize(batch_size);
+        free_batches.push(&batch);
+    }
+
+    // take a batch from a stage's input queue, recording the queue depth
+    struct Tally {
+        double busy_seconds = 0;
+        size_t depth_sum = 0;
+        size_t max_depth = 0;
+        size_t num_taken = 0;
+    };
+    vector <Tally> tallies(3);
+    auto take = [](SpscQueue <Batch*>& queue, Tally& tally, Batch*& batch) {
+        size_t depth = queue.size();
+        if (!queue.pop(batch)) {return false;}
+        tally.depth_sum += depth;
+        tally.max_depth = std::max(tally.max_depth, depth);
+        tally.num_taken++;
+        return true;
+    };
+
+    // on failure, stop every stage
+    std::exception_ptr error;
+    std::mutex error_lock;
+    auto fail = [&]() {
+        std::lock_guard <std::mutex> guard(error_lock);
+        if (!error) {error = std::current_exception();}
+        free_batches.close();
+        tokenized.close();
+        weighed.close();
+    };
+
+    // stage 1: tokenize
+    std::thread tokenize_thread([&]() {
+        try {
+            for (size_t front = 0; front < docs.size(); front += batch_size) {
+                Batch* batch;
+                if (!take(free_batches, tallies[0], batch)) {break;}
+                clock::time_point begin = clock::now();
+                batch->front = front;
+                batch->back = std::min(front + batch_size, docs.size());
+                for (size_t doc_num = batch->front; doc_num < batch->back; doc_num++) {
+                    _model._tokenize(docs[doc_num], batch->tokenizers[doc_num - front]);
+                }
+                tallies[0].busy_seconds += since(begin);
+                if (!tokenized.push(std::move(batch))) {break;}
+            }
+            tokenized.close();
+        }
+        catch (...) {fail();}
+    });
+
+    // stage 2: look up and weigh phrases
+    std::thread lookup_thread([&]() {
+        try {
+            Batch* batch;
+            while (take(tokenized, tallies[1], batch)) {
+                clock::time_point begin = clock::now();
+                for (size_t b = 0; b < batch->back - batch->front; b++) {
+                    VHash::Tokenizer& tokenizer = batch->tokenizers[b];
+                    _model._lookup(tokenizer);
+                    VHASH_STATS_TIME(_model._stats, vectorize);
+                    batch->weighted[b] = _model._weigh(tokenizer.indices);
+                }
+                tallies[1].busy_seconds += since(begin);
+                if (!weighed.push(std::move(batch))) {break;}
+            }
+            weighed.close();
+        }
+        catch (...) {fail();}
+    });
+
+    // stage 3: project onto features (on this thread), recycling batches
+    try {
+        bool quantized = _model._quantize == VHash::Quantize::int8;
+        vector <int32_t> sums(quantized? _model._features_size: 0);
+        Batch* batch;
+        while (take(weighed, tallies[2], batch)) {
+            clock::time_point begin = clock::now();
+            for (size_t doc_num = batch->front; doc_num < batch->back; doc_num++) {
+                VHASH_STATS_ADD(_model._stats, docs_transformed, 1);
+                VHASH_STATS_TIME(_model._stats, scatter);
+                float* row = out + doc_num * row_stride;
+                _model._scatter(batch->weighted[doc_num - batch->front], row, sums.data());
+            }
+            tallies[2].busy_seconds += since(begin);
+            free_batches.push(std::move(batch));
+        }
+    }
+    catch (...) {fail();}
+    tokenize_thread.join();
+    lookup_thread.join();
+    if (error) {std::rethrow_exception(error);}
+
+    // record stats
+    _num_docs = docs.size();
+    _seconds = since(start);
+    const char* names[] = {"tokenize", "lookup", "project"};
+    _stages.assign(3, StageStats());
+    for (size_t s = 0; s < 3; s++) {
+        const Tally& tally = tallies[s];
+        _stages[s].name = names[s];
+        _stages[s].busy_seconds = tally.busy_seconds;
+        _stages[s].utilization = _seconds > 0? tally.busy_seconds / _seconds: 0;
+        _stages[s].mean_queue_depth = tally.num_taken? (double)tally.depth_sum / tally.num_taken: 0;
+        _stages[s].max_queue_depth = tally.max_depth;
+    }
+}
+
+vector <vector <float>> VHashPipeline::transform(const vector <string>& docs) {
+    size_t num_features = _model.num_features();
+    vector <float> values(docs.size() * num_features);
+    transform(docs, values.data(), num_features);
+    vector <vector <float>> out(docs.size());
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+        const float* row = values.data() + doc_num * num_features;
+        out[doc_num].assign(row, row + num_features);
+    }
+    return out;
+}
+
+#ifndef __CXX_TESTING__
+py::array VHashPipeline::transform_numpy(const vector <string>& docs) {
+    size_t num_features = _model.num_features();
+    py::array_t <float> out({docs.size(), num_features});
+    float* data = out.mutable_data();
+    {
+        py::gil_scoped_release release;
+        transform(docs, data, num_features);
+    }
+    return out;
+}
+
+py::dict VHashPipeline::stats_dict() const {
+    py::dict stages;
+    for (const StageStats& stage: _stages) {
+        py::dict values;
+        values["busy_seconds"] = stage.busy_seconds;
+        values["utilization"] = stage.utilization;
+        values["mean_queue_depth"] = stage.mean_queue_depth;
+        values["max_queue_depth"] = stage.max_queue_depth;
+        stages[py::str(stage.name)] = values;
+    }
+    py::dict out;
+    out["num_docs"] = _num_docs;
+    out["seconds"] = _seconds;
+    out["docs_per_second"] = docs_per_second();
+    out["stages"] = stages;
+    return out;
+}
+#endif
+
+void VHashPipeline::_test() {
+    _test_transform();
+    _test_stats();
+    _test_errors();
+}
+
+// random docs, for testing
+static vector <string> _random_docs(const size_t& num_docs) {
+    vector <string> docs;
+    for (size_t doc_num = 0; doc_num < num_docs; doc_num++) {
+        string doc;
+        size_t num_words = manip::rand_index(30);
+        for (size_t word = 0; word < num_words; word++) {
+            doc += "w" + std::to_string(manip::rand_index(50 + 50 * (doc_num % 2))) + " ";
+        }
+        docs.push_back(doc);
+    }
+    return docs;
+}
+
+// fitted model, for testing
+static VHash _test_model(const string& quantize = "none", const bool& intern_words = false) {
+    vector <string> docs = _random_docs(200);
+    vector <size_t> labels;
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+        labels.push_back(doc_num % 2);
+    }
+    return VHash(
+        2, 1E-3, 20, 1E6, 100E3, 10E3, 1, intern_words, 1, 0, quantize
+    ).fit(docs, labels);
+}
+
+void VHashPipeline::_test_transform() {
+    vector <string> docs = _random_docs(301);
+    for (const char* quantize: {"none", "fp16", "int8"}) {
+        for (bool intern_words: {false, true}) {
+            VHash model = _test_model(quantize, intern_words);
+            vector <vector <float>> expected = model.transform(docs);
+
+            // output matches transform(), however docs are batched
+            for (size_t batch_size: {1, 7, 64, 1000}) {
+                for (size_t num_batches: {3, 8}) {
+                    VHashPipeline pipeline(model, batch_size, num_batches);
+                    assert(pipeline.transform(docs) == expected);
+                }
+            }
+        }
+    }
+
+    // rows are written with a stride, leaving the gaps alone
+    VHash model = _test_model();
+    size_t num_features = model.num_features(), row_stride = num_features + 3;
+    vector <float> out(docs.size() * row_stride, -7);
+    VHashPipeline(model, 5).transform(docs, out.data(), row_stride);
+    vector <vector <float>> expected = model.transform(docs);
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+        const float* row = out.data() + doc_num * row_stride;
+        assert(vector <float>(row, row + num_features) == expected[doc_num]);
+        assert(row[num_features] == -7);
+    }
+
+    // no docs
+    assert(VHashPipeline(model).transform(vector <string>()).empty());
+}
+
+void VHashPipeline::_test_stats() {
+    vector <string> docs = _random_docs(500);
+    VHashPipeline pipeline(_test_model(), 10, 4);
+    assert(pipeline.num_docs() == 0 && pipeline.stage_stats().empty());
+    pipeline.transform(docs);
+
+    // throughput
+    assert(pipeline.num_docs() == docs.size());
+    assert(pipeline.seconds() > 0);
+    assert(std::fabs(pipeline.docs_per_second() * pipeline.seconds() - docs.size()) < 1E-3);
+
+    // stages
+    const vector <StageStats>& stages = pipeline.stage_stats();
+    assert(stages.size() == 3);
+    assert(stages[0].name == "tokenize");
+    assert(stages[1].name == "lookup");
+    assert(stages[2].name == "project");
+    for (const StageStats& stage: stages) {
+        assert(stage.busy_seconds >= 0);
+        assert(stage.busy_seconds <= pipeline.seconds());
+        assert(stage.utilization >= 0 && stage.utilization <= 1);
+        assert(stage.max_queue_depth <= pipeline.num_batches());
+        assert(stage.mean_queue_depth <= stage.max_queue_depth);
+    }
+
+    // every batch starts out free
+    assert(stages[0].max_queue_depth == 4);
+}
+
+void VHashPipeline::_test_errors() {
+    VHash model = _test_model();
+    for (size_t batch_size: {0, 1}) {
+        for (size_t num_batches: {2, 3}) {
+            bool caught = false;
+            try {VHashPipeline(model, batch_size, num_batches);}
+            catch (const std::invalid_argument&) {caught = true;}
+            assert(caught == (!batch_size || num_batches < 3));
+        }
+    }
+}
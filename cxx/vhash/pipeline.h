@@ -0,0 +1,175 @@
+#ifndef VHASH_PIPELINE_H
+#define VHASH_PIPELINE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <vhash/vhash.h>
+
+#ifndef __CXX_TESTING__
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+namespace py = pybind11;
+#endif
+
+using std::string;
+using std::vector;
+
+
+namespace vhash {
+
+    /* Transform documents in a pipeline of concurrent stages
+
+    Documents are grouped into batches, which flow through three stages,
+    each running on its own thread:
+
+        1. tokenize: parse each document into phrases
+        2. lookup: find each phrase in the table, and weight the phrases
+        3. project: take the dot product of each weighted document with
+           each feature, writing the output rows
+
+    Stages are connected by bounded lock-free queues of batches, so (e.g.)
+    tokenizing batch N+1 overlaps projecting batch N. A fixed pool of
+    batches is recycled from the last stage back to the first, which bounds
+    memory, and makes a fast stage wait for a slow one.
+
+    After each transform, stage stats show how long each stage was busy,
+    and how many batches were waiting for it: the stage that saturates is
+    busy most of the time, with batches queued up in front of it.
+    */
+    class VHashPipeline {
+        public:
+
+            /* What one stage did during the last transform */
+            struct StageStats {
+
+                /* stage name: "tokenize", "lookup" or "project" */
+                string name;
+
+                /* seconds spent working on batches (not waiting) */
+                double busy_seconds = 0;
+
+                /* busy seconds, as a fraction of the transform's duration */
+                double utilization = 0;
+
+                /* number of batches waiting in the stage's input queue (for
+                tokenize, the free batches recycled from project), averaged
+                over, and maximized over, each time the stage took a batch */
+                double mean_queue_depth = 0;
+                size_t max_queue_depth = 0;
+            };
+
+            /* Constructor
+
+            Parameters
+            ----------
+            model: const VHash&
+                fitted model, used to transform documents
+            batch_size: const size_t&
+                number of documents in each batch
+            num_batches: const size_t&
+                number of batches in flight (at least 3, so every stage can
+                work at once)
+
+            Raises
+            ------
+            std::invalid_argument
+                if batch_size is 0, or num_batches is less than 3
+             */
+            VHashPipeline(
+                const VHash& model,
+                const size_t& batch_size = 64,
+                const size_t& num_batches = 8
+            );
+
+            /* Transform docs into a row-major buffer
+
+            Output matches VHash::transform().
+
+            Parameters
+            ----------
+            docs: const vector <string>&
+                documents to transform
+            out: float*
+                output, with a row of `model.num_features()` values for each
+                document
+            row_stride: const size_t&
+                number of floats between the starts of consecutive rows
+             */
+            void transform(
+                const vector <string>& docs,
+                float* out,
+                const size_t& row_stride
+            );
+
+            /* Transform docs
+
+            Parameters
+            ----------
+            docs: const vector <string>&
+                documents to transform
+
+            Returns
+            -------
+            vector <vector <float>>
+                transformed vector of each document
+             */
+            vector <vector <float>> transform(const vector <string>& docs);
+
+            // ===============================================================
+            // Stats (of the last transform)
+
+            /* Number of documents transformed */
+            size_t num_docs() const {return _num_docs;}
+
+            /* Wall-clock duration, in seconds */
+            double seconds() const {return _seconds;}
+
+            /* Throughput, in documents per second */
+            double docs_per_second() const {
+                return _seconds > 0? _num_docs / _seconds: 0;
+            }
+
+            /* Stats for each stage, in pipeline order */
+            const vector <StageStats>& stage_stats() const {return _stages;}
+
+            // ===============================================================
+            // Meta-data
+
+            /* Number of documents in each batch */
+            size_t batch_size() const {return _batch_size;}
+
+            /* Number of batches in flight */
+            size_t num_batches() const {return _num_batches;}
+
+            // numpy support
+            #ifndef __CXX_TESTING__
+            py::array transform_numpy(const vector <string>& docs);
+            py::dict stats_dict() const;
+            #endif
+
+            // tests
+            static void _test();
+
+        private:
+
+            // model, for transforming documents
+            VHash _model;
+
+            // batching parameters
+            size_t _batch_size;
+            size_t _num_batches;
+
+            // stats of the last transform
+            size_t _num_docs = 0;
+            double _seconds = 0;
+            vector <StageStats> _stages;
+
+            // tests
+            static void _test_transform();
+            static void _test_stats();
+            static void _test_errors();
+    };
+}
+#endif
@@ -0,0 +1,76 @@
+#include <vhash/stats.h>
+
+using namespace vhash;
+
+
+const char* const Stats::stage_names[(size_t)Stage::size] = {
+    "tokenize",
+    "count",
+    "merge",
+    "prune",
+    "lookup",
+    "vectorize",
+    "scatter",
+};
+
+const char* const Stats::counter_names[(size_t)Counter::size] = {
+    "docs_fit",
+    "docs_transformed",
+    "phrases_generated",
+    "phrases_found",
+    "phrases_oov",
+    "prunes",
+    "phrases_pruned",
+};
+
+Stats& Stats::operator=(const Stats& other) {
+    for (size_t stage = 0; stage < (size_t)Stage::size; stage++) {
+        _nanoseconds[stage] = other._nanoseconds[stage].load();
+    }
+    for (size_t counter = 0; counter < (size_t)Counter::size; counter++) {
+        _counts[counter] = other._counts[counter].load();
+    }
+    for (size_t bucket = 0; bucket < num_buckets; bucket++) {
+        _latencies[bucket] = other._latencies[bucket].load();
+    }
+    return *this;
+}
+
+void Stats::add_latency(const uint64_t& nanoseconds) {
+    size_t bucket = 0;
+    for (uint64_t us = nanoseconds / 1000; us && bucket < num_buckets - 1; us >>= 1) {
+        bucket++;
+    }
+    _latencies[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void Stats::reset() {
+    *this = Stats();
+}
+
+Stats::Timer::~Timer() {
+    uint64_t elapsed = std::chrono::duration_cast <std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - _start
+    ).count();
+    if (_stage == Stage::size) {
+        _stats.add_latency(elapsed);
+    } else {
+        _stats.add_time(_stage, elapsed);
+    }
+}
+
+double Stats::seconds(const Stage& stage) const {
+    return _nanoseconds[(size_t)stage].load() / 1E9;
+}
+
+uint64_t Stats::count(const Counter& counter) const {
+    return _counts[(size_t)counter].load();
+}
+
+vector <uint64_t> Stats::latency_histogram() const {
+    vector <uint64_t> out(num_buckets);
+    for (size_t bucket = 0; bucket < num_buckets; bucket++) {
+        out[bucket] = _latencies[bucket].load();
+    }
+    return out;
+}
@@ -0,0 +1,152 @@
+#ifndef VHASH_STATS_H
+#define VHASH_STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using std::vector;
+
+
+/* Instrumentation points
+
+Stats are only collected if compiled with VHASH_STATS defined (e.g. with
+`make STATS=1`, or `VHASH_STATS=1 pip install .`). Otherwise, these macros
+compile to nothing, and all stats stay zero.
+
+VHASH_STATS_TIME(stats, stage)
+    add the time until the end of the enclosing scope to a stage
+VHASH_STATS_LATENCY(stats)
+    add the time until the end of the enclosing scope to the histogram of
+    per-document latencies
+VHASH_STATS_ADD(stats, counter, amount)
+    add to a counter
+VHASH_STATS_ONLY(...)
+    only compile statement if collecting stats
+ */
+#ifdef VHASH_STATS
+#define VHASH_STATS_TIME(stats, stage) \
+    vhash::Stats::Timer _stats_timer_##stage((stats), vhash::Stats::Stage::stage)
+#define VHASH_STATS_LATENCY(stats) \
+    vhash::Stats::Timer _stats_latency_timer((stats))
+#define VHASH_STATS_ADD(stats, counter, amount) \
+    (stats).add(vhash::Stats::Counter::counter, (amount))
+#define VHASH_STATS_ONLY(...) __VA_ARGS__
+#else
+#define VHASH_STATS_TIME(stats, stage)
+#define VHASH_STATS_LATENCY(stats)
+#define VHASH_STATS_ADD(stats, counter, amount)
+#define VHASH_STATS_ONLY(...)
+#endif
+
+
+namespace vhash {
+
+    /* Time spent in each stage of fitting and transforming, counts of what
+    was processed, and a histogram of per-document transform latencies
+
+    Updates are relaxed atomic additions, so one object can be shared by
+    all threads. Copies take a snapshot of the values.
+     */
+    class Stats {
+        public:
+
+            /* whether stats are collected (i.e. VHASH_STATS is defined) */
+            #ifdef VHASH_STATS
+            static constexpr bool enabled = true;
+            #else
+            static constexpr bool enabled = false;
+            #endif
+
+            /* stages, which are timed */
+            enum class Stage {
+                tokenize,   // formatting docs, splitting words and interning them
+                count,      // generating phrases and counting them (fitting)
+                merge,      // merging per-thread counts (fitting)
+                prune,      // removing infrequent phrases (fitting)
+                lookup,     // generating phrases and finding them in the table
+                vectorize,  // weighting and normalizing found phrases
+                scatter,    // taking dot products with features (transforming)
+                size
+            };
+
+            /* counters */
+            enum class Counter {
+                docs_fit,           // docs counted, while fitting
+                docs_transformed,   // docs transformed
+                phrases_generated,  // phrases generated from docs
+                phrases_found,      // phrases found in the table
+                phrases_oov,        // phrases not in the table
+                prunes,             // times infrequent phrases were removed
+                phrases_pruned,     // phrases removed as infrequent
+                size
+            };
+
+            /* number of latency histogram buckets: bucket 0 counts latencies
+            under 1us, bucket `b` counts those in [2^(b-1), 2^b) us, and the
+            last bucket also counts anything longer */
+            static constexpr size_t num_buckets = 24;
+
+            /* names of stages and counters (in order) */
+            static const char* const stage_names[(size_t)Stage::size];
+            static const char* const counter_names[(size_t)Counter::size];
+
+            // ===============================================================
+            // Constructors
+
+            Stats() {}
+            Stats(const Stats& other) {*this = other;}
+            Stats& operator=(const Stats& other);
+
+            // ===============================================================
+            // Recording
+
+            /* Add time to a stage */
+            void add_time(const Stage& stage, const uint64_t& nanoseconds) {
+                _nanoseconds[(size_t)stage].fetch_add(nanoseconds, std::memory_order_relaxed);
+            }
+
+            /* Add to a counter */
+            void add(const Counter& counter, const uint64_t& amount) {
+                _counts[(size_t)counter].fetch_add(amount, std::memory_order_relaxed);
+            }
+
+            /* Add a per-document latency to the histogram */
+            void add_latency(const uint64_t& nanoseconds);
+
+            /* Reset all stats to zero */
+            void reset();
+
+            /* Times a scope, adding to a stage (or to the latency histogram) */
+            class Timer {
+                public:
+                    Timer(Stats& stats, const Stage& stage): _stats(stats), _stage(stage) {}
+                    Timer(Stats& stats): _stats(stats), _stage(Stage::size) {}
+                    ~Timer();
+                private:
+                    Stats& _stats;
+                    Stage _stage;
+                    std::chrono::steady_clock::time_point _start = std::chrono::steady_clock::now();
+            };
+
+            // ===============================================================
+            // Access
+
+            /* Total time spent in stage, in seconds */
+            double seconds(const Stage& stage) const;
+
+            /* Value of counter */
+            uint64_t count(const Counter& counter) const;
+
+            /* Per-document latency histogram (see num_buckets) */
+            vector <uint64_t> latency_histogram() const;
+
+        private:
+            std::atomic <uint64_t> _nanoseconds[(size_t)Stage::size] = {};
+            std::atomic <uint64_t> _counts[(size_t)Counter::size] = {};
+            std::atomic <uint64_t> _latencies[num_buckets] = {};
+    };
+}
+#endif
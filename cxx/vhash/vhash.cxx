@@ -1,8 +1,18 @@
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <numeric>
+#include <shared_mutex>
+#include <sstream>
+#include <thread>
 
 #include <utils/files.h>
 #include <utils/manip.h>
 #include <utils/maths.h>
+#include <utils/parallel.h>
 #include <utils/text.h>
 #include <vhash/vhash.h>
 
@@ -17,7 +27,13 @@ VHash::VHash(
     const size_t& max_num_phrases,
     const size_t& downsample_to,
     const size_t& live_evaluation_step,
-    const size_t& smallest_ngram
+    const size_t& smallest_ngram,
+    const bool&   intern_words,
+    const int&    n_jobs,
+    const size_t& memory_budget,
+    const string& quantize,
+    const size_t& max_feature_terms,
+    const float&  feature_mass
 ):
     _largest_ngram(largest_ngram),
     _min_phrase_occurrence(min_phrase_occurrence),
@@ -25,27 +41,40 @@ VHash::VHash(
     _max_num_phrases(max_num_phrases),
     _downsample_to(downsample_to),
     _live_evaluation_step(live_evaluation_step),
-    _smallest_ngram(smallest_ngram) {
+    _smallest_ngram(smallest_ngram),
+    _intern_words(intern_words),
+    _n_jobs(n_jobs),
+    _memory_budget(memory_budget),
+    _max_feature_terms(max_feature_terms),
+    _feature_mass(feature_mass) {
+
+    // parse quantization
+    if (quantize == "fp16") {_quantize = Quantize::fp16;}
+    else if (quantize == "int8") {_quantize = Quantize::int8;}
+    else if (quantize != "none") {
+        throw std::invalid_argument(
+            "quantize must be 'none', 'fp16' or 'int8' (got '" + quantize + "')"
+        );
+    }
+
+    // check feature capping
+    if (!(feature_mass > 0 && feature_mass <= 1)) {
+        throw std::invalid_argument(
+            "feature_mass must be in (0, 1] (got " + std::to_string(feature_mass) + ")"
+        );
+    }
+
+    // check number of threads (throwing if 0)
+    parallel::num_threads(n_jobs);
 }
 
 VHash VHash::fit(
     const vector <string>& docs,
     const vector <size_t>& labels
 ) {
-    // downsample docs
-    _num_docs = maths::min(vector <size_t>{docs.size(), _downsample_to});
-    vector <char> insert_me = manip::rand_select(docs.size(), _num_docs);
-
-    // create table
-    _create_table(docs, insert_me);
-
-    // compute weights
-    _compute_weights(docs, labels, insert_me);
-
-    // make features
-    _make_features(docs);
-
-    // return
+    std::unique_lock <std::shared_mutex> guard(_lock.mutex);
+    Scan scan;
+    _fit(_views(docs), labels, scan);
     return *this;
 }
 
@@ -53,120 +82,536 @@ vector <vector <float>> VHash::fit_transform(
     const vector <string>& docs,
     const vector <size_t>& labels
 ) {
-    return fit(docs, labels).transform(docs);
+    std::unique_lock <std::shared_mutex> guard(_lock.mutex);
+    vector <string_view> views = _views(docs);
+    Scan scan;
+    _fit(views, labels, scan);
+    return _transform(views, &scan);
+}
+
+void VHash::partial_fit(
+    const vector <string>& docs,
+    const vector <size_t>& labels
+) {
+    std::unique_lock <std::shared_mutex> guard(_lock.mutex);
+
+    // check labels (before changing any counts)
+    if (labels.size() != docs.size()) {
+        throw std::invalid_argument(
+            "Number of labels (" + std::to_string(labels.size()) +
+            ") doesn't match number of docs (" + std::to_string(docs.size()) + ")"
+        );
+    }
+
+    // start counting, if this is the first batch
+    if (!_counter.num_docs) {
+        _start_counting(!labels.empty());
+        _samples.clear();
+    }
+
+    // sample docs for features (reservoir sampling)
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+        size_t seen = _counter.num_docs + doc_num;
+        if (_samples.size() < _num_features) {
+            _samples.push_back(string(docs[doc_num]));
+            continue;
+        }
+        size_t replace = manip::rand_index(seen + 1);
+        if (replace < _num_features) {_samples[replace] = string(docs[doc_num]);}
+    }
+
+    // count phrases and document frequencies
+    if (!labels.empty()) {
+        size_t num_classes = maths::max(labels) + 1;
+        if (num_classes > _counter.num_classes) {_counter.set_num_classes(num_classes);}
+    }
+    _count_docs(_views(docs), vector <char>(docs.size(), true), &labels, nullptr);
+}
+
+void VHash::finalize() {
+    std::unique_lock <std::shared_mutex> guard(_lock.mutex);
+
+    // finish table
+    _num_docs = _counter.num_docs;
+    _finish_counting();
+
+    // compute weights
+    _compute_weights(_counter.docs_in_class, _counter.doc_freq);
+
+    // make features from sampled docs
+    Scan scan;
+    scan.scanned.assign(_samples.size(), false);
+    _make_features(_views(_samples), scan);
+
+    // free fitting structures
+    _counter = Counter();
+    vector <string>().swap(_samples);
 }
 
 vector <vector <float>> VHash::transform(
     const vector <string>& docs
 ) {
-    vector <vector <float>> out(docs.size(), vector <float>(_features.size()));
+    std::shared_lock <std::shared_mutex> guard(_lock.mutex);
+    return _transform(_views(docs), nullptr);
+}
+
+void VHash::transform(
+    const vector <string>& docs,
+    float* out,
+    const size_t& row_stride
+) {
+    std::shared_lock <std::shared_mutex> guard(_lock.mutex);
+    _transform(_views(docs), out, row_stride, nullptr);
+}
+
+void VHash::transform(
+    const vector <string>& docs,
+    uint16_t* out,
+    const size_t& row_stride
+) {
+    std::shared_lock <std::shared_mutex> guard(_lock.mutex);
+    _transform(_views(docs), out, row_stride, nullptr);
+}
+
+void VHash::transform(
+    const vector <string>& docs,
+    int8_t* out,
+    const size_t& row_stride
+) {
+    std::shared_lock <std::shared_mutex> guard(_lock.mutex);
+    _transform(_views(docs), out, row_stride, nullptr);
+}
+
+VHash VHash::fit_file(
+    const string& path,
+    const string& labels_path
+) {
+    // map docs (which must outlive fitting), read front to back
+    files::MappedFile file(path, files::Access::sequential);
+    vector <string_view> docs = files::lines(file.view());
+
+    // read labels (putting every doc in one class, if unlabeled)
+    vector <size_t> labels;
+    if (labels_path.empty()) {
+        labels.assign(docs.size(), 0);
+    }
+    else {
+        files::MappedFile labels_file(labels_path);
+        labels = _class_labels(files::lines(labels_file.view()));
+        if (labels.size() != docs.size()) {
+            throw std::invalid_argument(
+                "Number of labels (" + std::to_string(labels.size()) +
+                ") doesn't match number of docs (" + std::to_string(docs.size()) + ")"
+            );
+        }
+    }
+
+    // fit
+    std::unique_lock <std::shared_mutex> guard(_lock.mutex);
+    Scan scan;
+    _fit(docs, labels, scan);
+    return *this;
+}
+
+void VHash::transform_sparse(
+    const vector <string>& docs,
+    vector <float>& data,
+    vector <int32_t>& indices,
+    vector <int64_t>& indptr
+) {
+    std::shared_lock <std::shared_mutex> guard(_lock.mutex);
+
+    // split docs into chunks of similar length
+    size_t num_threads = parallel::num_threads(_n_jobs);
+    vector <size_t> doc_sizes(docs.size());
     for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
-        Sparse vectorized = 
-            _vectorize(docs[doc_num])
-            .multiply(_weights, true)
-            .normalize()
-        ;
-        for (size_t feature_num = 0; feature_num < _features.size(); feature_num++) {
-            out[doc_num][feature_num] = vectorized.dot_product(_features[feature_num]);
+        doc_sizes[doc_num] = docs[doc_num].size() + 1;
+    }
+    vector <size_t> chunks = parallel::split(doc_sizes, num_threads);
+    size_t num_chunks = chunks.size() - 1;
+
+    // weigh docs in each chunk, into buffers for the chunk (recording the
+    // number of values in each row)
+    indptr.assign(docs.size() + 1, 0);
+    vector <vector <int32_t>> chunk_indices(num_chunks);
+    vector <vector <float>> chunk_values(num_chunks);
+    vector <Tokenizer> tokenizers(num_threads, Tokenizer(*this));
+    parallel::for_each(num_chunks, num_threads, [&](const size_t& chunk, const size_t& thread) {
+        vector <int32_t>& out_indices = chunk_indices[chunk];
+        vector <float>& out_values = chunk_values[chunk];
+        for (size_t doc_num = chunks[chunk]; doc_num < chunks[chunk + 1]; doc_num++) {
+            VHASH_STATS_LATENCY(_stats);
+            VHASH_STATS_ADD(_stats, docs_transformed, 1);
+            Tokenizer& tokenizer = tokenizers[thread];
+            _find_indices(docs[doc_num], tokenizer);
+            VHASH_STATS_TIME(_stats, vectorize);
+            size_t size = out_values.size();
+            out_indices.resize(size + tokenizer.indices.size());
+            out_values.resize(size + tokenizer.indices.size());
+            size_t num_nonzero = _weigh(tokenizer.indices, &out_indices[size], &out_values[size]);
+            out_indices.resize(size + num_nonzero);
+            out_values.resize(size + num_nonzero);
+            indptr[doc_num + 1] = num_nonzero;
         }
+    });
+
+    // offsets of rows (and so chunks) in output
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+        indptr[doc_num + 1] += indptr[doc_num];
     }
-    return out;
+
+    // copy chunks into place
+    data.resize(indptr.back());
+    indices.resize(indptr.back());
+    parallel::for_each(num_chunks, num_threads, [&](const size_t& chunk, const size_t&) {
+        size_t offset = indptr[chunks[chunk]];
+        std::copy(chunk_values[chunk].begin(), chunk_values[chunk].end(), data.begin() + offset);
+        std::copy(chunk_indices[chunk].begin(), chunk_indices[chunk].end(), indices.begin() + offset);
+    });
 }
 
-#ifndef __CXX_TESTING__
-py::tuple VHash::__get_state__(const vhash::VHash &v) {
-    
-    // serialize hash table
-    size_t hash_size = v._table.size();
-    vector <string> hash_keys;
-    vector <size_t> hash_values;
-    for (auto it = v._table.begin(); it != v._table.end(); it++) {
-        hash_keys.push_back((*it).first);
-        hash_values.push_back((*it).second);
-    }
-
-    // serialize features
-    size_t features_size = v._features.size();
-    vector <size_t> features_max_index;
-    vector <vector <size_t>> features_index;
-    vector <vector <float>> features_value;
-    for (auto feature: v._features) {
-        features_max_index.push_back(feature.max_index);
-        features_index.push_back(feature.indices);
-        features_value.push_back(feature.values);
-    }
-
-    // return state
-    return py::make_tuple(
-        v._largest_ngram,
-        v._min_phrase_occurrence,
-        v._num_features,
-        v._max_num_phrases,
-        v._downsample_to,
-        v._live_evaluation_step,
-        v._smallest_ngram,
-        v._num_docs,
-        hash_size,
-        hash_keys,
-        hash_values,
-        features_size,
-        features_max_index,
-        features_index,
-        features_value,
-        v._weights
+void VHash::transform_file(
+    const string& path,
+    const string& out_path
+) {
+    std::shared_lock <std::shared_mutex> guard(_lock.mutex);
+
+    // map docs (read front to back)
+    files::MappedFile file(path, files::Access::sequential);
+    vector <string_view> docs = files::lines(file.view());
+
+    // create output
+    string header = files::npy_header(docs.size(), _features_size);
+    files::MappedFile out = files::MappedFile::create(
+        out_path,
+        header.size() + docs.size() * _features_size * sizeof(float)
     );
+    memcpy(out.data(), header.data(), header.size());
+
+    // transform into output
+    _transform(docs, (float*)(out.data() + header.size()), _features_size, nullptr);
 }
 
-VHash VHash::__set_state__(py::tuple t) {
-    
-    // initialize
-    VHash v;
-    size_t g = 0;
-
-    // set parameters
-    v._largest_ngram = t[g++].cast<size_t>();
-    v._min_phrase_occurrence = t[g++].cast<float>();
-    v._num_features = t[g++].cast<size_t>();
-    v._max_num_phrases = t[g++].cast<size_t>();
-    v._downsample_to = t[g++].cast<size_t>();
-    v._live_evaluation_step = t[g++].cast<size_t>();
-    v._smallest_ngram = t[g++].cast<size_t>();
-    v._num_docs = t[g++].cast<size_t>();
-
-    // reconstruct hash table
-    size_t hash_size = t[g++].cast<size_t>();
-    vector <string> hash_keys = t[g++].cast<vector <string>>();
-    vector <size_t> hash_values = t[g++].cast<vector <size_t>>();
-    for (size_t h = 0; h < hash_size; h++) {
-        v._table.insert(
-            std::pair <string, size_t>(
-                hash_keys[h],
-                hash_values[h]
-            )
-        );
+void VHash::save(const string& path) const {
+    std::shared_lock <std::shared_mutex> guard(_lock.mutex);
+
+    // write to a new file, then replace (so models viewing the old file stay valid)
+    string temp_path = path + ".tmp";
+    ofstream file = files::open <ofstream>(temp_path);
+    _write(file);
+    file.close();
+    if (!file || std::rename(temp_path.c_str(), path.c_str())) {
+        std::remove(temp_path.c_str());
+        throw std::runtime_error("Could not write file: " + path);
     }
+}
 
-    // load in features
-    size_t features_size = t[g++].cast<size_t>();
-    vector <size_t> features_max_index = t[g++].cast<vector <size_t>>();
-    vector <vector <size_t>> features_index = t[g++].cast<vector <vector <size_t>>>();
-    vector <vector <float>> features_value = t[g++].cast<vector <vector <float>>>();
-    for (size_t h = 0; h < features_size; h++) {
-        v._features.push_back(
-            Sparse(
-                features_max_index[h],
-                features_value[h],
-                features_index[h]
-            )
+VHash VHash::load(const string& path) {
+    files::MappedReader reader(path, files::Access::willneed);
+    return _read(reader, path);
+}
+
+void VHash::_write(ostream& file) const {
+
+    // header
+    file.write(_file_magic, sizeof(_file_magic));
+    files::binary_write <uint32_t>(file, _file_version);
+    files::binary_write <uint32_t>(file, _file_byte_order);
+
+    // construction parameters
+    files::binary_write <uint64_t>(file, _largest_ngram);
+    files::binary_write <float>(file, _min_phrase_occurrence);
+    files::binary_write <uint64_t>(file, _num_features);
+    files::binary_write <uint64_t>(file, _max_num_phrases);
+    files::binary_write <uint64_t>(file, _downsample_to);
+    files::binary_write <uint64_t>(file, _live_evaluation_step);
+    files::binary_write <uint64_t>(file, _smallest_ngram);
+    files::binary_write <uint8_t>(file, _intern_words);
+    files::binary_write <int32_t>(file, _n_jobs);
+    files::binary_write <uint64_t>(file, _memory_budget);
+    files::binary_write <uint8_t>(file, (uint8_t)_quantize);
+    files::binary_write <uint64_t>(file, _max_feature_terms);
+    files::binary_write <float>(file, _feature_mass);
+
+    // fitted model
+    files::binary_write <uint64_t>(file, _num_docs);
+    files::binary_write <uint64_t>(file, _features_size);
+    _table.write(file);
+    _words.write(file);
+    files::binary_write_aligned(file, _postings_start.data(), _postings_start.size());
+    files::binary_write_aligned(file, _postings_feature.data(), _postings_feature.size());
+    files::binary_write_aligned(file, _postings_value.data(), _postings_value.size());
+    files::binary_write_aligned(file, _weights.data(), _weights.size());
+    files::binary_write_aligned(file, _postings_half.data(), _postings_half.size());
+    files::binary_write_aligned(file, _postings_int8.data(), _postings_int8.size());
+    files::binary_write_aligned(file, _feature_scales.data(), _feature_scales.size());
+    files::binary_write_aligned(file, _weights_half.data(), _weights_half.size());
+    files::binary_write_aligned(file, _feature_errors.data(), _feature_errors.size());
+}
+
+VHash VHash::_read(files::MappedReader& reader, const string& name) {
+
+    // check header
+    for (const char& c: _file_magic) {
+        if (reader.read <char>() != c) {
+            throw std::runtime_error("Not a VHash model file: " + name);
+        }
+    }
+    uint32_t version = reader.read <uint32_t>();
+    if (version != _file_version) {
+        throw std::runtime_error(
+            "Unsupported model file version " + std::to_string(version) +
+            " (expected " + std::to_string(_file_version) + "): " + name
         );
     }
+    if (reader.read <uint32_t>() != _file_byte_order) {
+        throw std::runtime_error("Model file has different byte order: " + name);
+    }
 
-    // reconstruct weights
-    v._weights = t[g++].cast<vector <float>>();
+    // construction parameters
+    VHash v;
+    v._largest_ngram = reader.read <uint64_t>();
+    v._min_phrase_occurrence = reader.read <float>();
+    v._num_features = reader.read <uint64_t>();
+    v._max_num_phrases = reader.read <uint64_t>();
+    v._downsample_to = reader.read <uint64_t>();
+    v._live_evaluation_step = reader.read <uint64_t>();
+    v._smallest_ngram = reader.read <uint64_t>();
+    v._intern_words = reader.read <uint8_t>();
+    v._n_jobs = reader.read <int32_t>();
+    v._memory_budget = reader.read <uint64_t>();
+    uint8_t quantize = reader.read <uint8_t>();
+    if (quantize > (uint8_t)Quantize::int8) {
+        throw std::runtime_error("Malformed model file: " + name);
+    }
+    v._quantize = (Quantize)quantize;
+    v._max_feature_terms = reader.read <uint64_t>();
+    v._feature_mass = reader.read <float>();
+
+    // fitted model (viewed in the mapped file)
+    v._num_docs = reader.read <uint64_t>();
+    v._features_size = reader.read <uint64_t>();
+    v._table = FrozenTable::read(reader);
+    v._words = FrozenTable::read(reader);
+    v._postings_start = reader.read_aligned <uint64_t>();
+    v._postings_feature = reader.read_aligned <uint32_t>();
+    v._postings_value = reader.read_aligned <float>();
+    v._weights = reader.read_aligned <float>();
+    v._postings_half = reader.read_aligned <uint16_t>();
+    v._postings_int8 = reader.read_aligned <int8_t>();
+    v._feature_scales = reader.read_aligned <float>();
+    v._weights_half = reader.read_aligned <uint16_t>();
+    v._feature_errors = reader.read_aligned <float>();
+
+    // get sizes of (possibly quantized) values and weights
+    bool quantized = v._quantize != Quantize::none;
+    size_t num_weights = quantized? v._weights_half.size(): v._weights.size();
+    size_t num_values = (
+        v._quantize == Quantize::fp16? v._postings_half.size():
+        v._quantize == Quantize::int8? v._postings_int8.size():
+        v._postings_value.size()
+    );
 
-    // return
+    // check that transforming stays in bounds
+    size_t num_phrases = v._table.size();
+    bool fitted = !v._postings_start.empty();
+    bool valid = fitted?
+        v._postings_start.size() == num_phrases + 1 &&
+        !v._postings_start[0] &&
+        v._postings_start.back() == v._postings_feature.size() &&
+        num_weights == num_phrases &&
+        v._feature_errors.size() == v._features_size:
+        v._postings_feature.empty()
+    ;
+    valid = valid && num_values == v._postings_feature.size();
+    if (v._quantize == Quantize::int8 && fitted) {
+        valid = valid && v._feature_scales.size() == v._features_size;
+    }
+    for (size_t index = 0; valid && fitted && index < num_phrases; index++) {
+        valid = v._postings_start[index] <= v._postings_start[index + 1];
+    }
+    for (size_t p = 0; valid && p < v._postings_feature.size(); p++) {
+        valid = v._postings_feature[p] < v._features_size;
+    }
+    if (!valid) {throw std::runtime_error("Malformed model file: " + name);}
     return v;
 }
+
+#ifndef __CXX_TESTING__
+// lock a model for a Python caller, waiting without the GIL (threads holding
+// the lock may take the GIL back, so threads holding the GIL mustn't wait)
+template <class L>
+static L _lock_without_gil(std::shared_mutex& mutex) {
+    py::gil_scoped_release release;
+    return L(mutex);
+}
+
+py::array VHash::fit_transform_numpy(
+    const vector <string>& docs,
+    const vector <size_t>& labels
+) {
+    auto guard = _lock_without_gil <std::unique_lock <std::shared_mutex>>(_lock.mutex);
+
+    // fit (releasing the GIL, so other Python threads can run)
+    vector <string_view> views = _views(docs);
+    Scan scan;
+    {
+        py::gil_scoped_release release;
+        _fit(views, labels, scan);
+    }
+
+    // transform into a new array
+    py::array_t <float> out({docs.size(), _features_size});
+    float* data = out.mutable_data();
+    {
+        py::gil_scoped_release release;
+        _transform(views, data, _features_size, &scan);
+    }
+    return out;
+}
+
+py::array VHash::transform_numpy(
+    const vector <string>& docs,
+    const py::object& out,
+    const string& dtype
+) {
+    // hold the model (so its number of features can't change before transforming)
+    auto guard = _lock_without_gil <std::shared_lock <std::shared_mutex>>(_lock.mutex);
+
+    // get output (allocating it, if not given)
+    py::array array;
+    if (out.is_none()) {
+        array = py::array(py::dtype(dtype), {docs.size(), _features_size});
+    }
+    else if (!py::isinstance <py::array>(out)) {
+        throw py::type_error("out must be a numpy array");
+    }
+    else {array = out.cast <py::array>();}
+
+    // check output type
+    char kind = array.dtype().kind();
+    size_t itemsize = array.itemsize();
+    bool is_float = kind == 'f' && itemsize == sizeof(float);
+    bool is_half = kind == 'f' && itemsize == sizeof(uint16_t);
+    bool is_int8 = kind == 'i' && itemsize == sizeof(int8_t);
+    if (!is_float && !is_half && !is_int8) {
+        throw py::value_error("out must have dtype float32, float16 or int8");
+    }
+
+    // check caller-provided output (which must be written in place)
+    if (array.ndim() != 2 || (size_t)array.shape(0) != docs.size() || (size_t)array.shape(1) != _features_size) {
+        throw py::value_error(
+            "out must have shape (" + std::to_string(docs.size()) + ", " +
+            std::to_string(_features_size) + ")"
+        );
+    }
+    if (!array.writeable()) {
+        throw py::value_error("out must be writeable");
+    }
+    bool contiguous_rows = _features_size <= 1 || (size_t)array.strides(1) == itemsize;
+    bool aligned_rows = docs.size() <= 1 || (array.strides(0) > 0 && array.strides(0) % itemsize == 0);
+    if (!contiguous_rows || !aligned_rows) {
+        throw py::value_error("out must have contiguous rows");
+    }
+
+    // transform (releasing the GIL, so other Python threads can run)
+    size_t row_stride = docs.size() <= 1? _features_size: array.strides(0) / itemsize;
+    void* data = array.mutable_data();
+    {
+        py::gil_scoped_release release;
+        vector <string_view> views = _views(docs);
+        if (is_float) {_transform(views, (float*)data, row_stride, nullptr);}
+        else if (is_half) {_transform(views, (uint16_t*)data, row_stride, nullptr);}
+        else {_transform(views, (int8_t*)data, row_stride, nullptr);}
+    }
+    return array;
+}
+#endif
+
+std::map <string, size_t> VHash::memory_usage() const {
+    std::shared_lock <std::shared_mutex> guard(_lock.mutex);
+
+    // fitting structures (only kept while partially fitting)
+    size_t fitting = _counter.memory() + _counter.sketch.memory();
+    fitting += _counter.docs_in_class.capacity() * sizeof(size_t);
+    for (const string& sample: _samples) {
+        fitting += sizeof(string) + sample.capacity();
+    }
+
+    // model
+    std::map <string, size_t> out = {
+        {"vocabulary_keys", _table.key_memory()},
+        {"vocabulary_index", _table.index_memory()},
+        {"word_keys", _words.key_memory()},
+        {"word_index", _words.index_memory()},
+        {"weights", _weights.memory() + _weights_half.memory()},
+        {"feature_indices", _postings_start.memory() + _postings_feature.memory()},
+        {"feature_values", (
+            _postings_value.memory() + _postings_half.memory() +
+            _postings_int8.memory() + _feature_scales.memory() +
+            _feature_errors.memory()
+        )},
+        {"fitting", fitting},
+    };
+
+    // total
+    size_t total = 0;
+    for (const auto& [component, bytes]: out) {
+        total += bytes;
+    }
+    out["total"] = total;
+    return out;
+}
+
+#ifndef __CXX_TESTING__
+py::tuple VHash::transform_sparse_numpy(const vector <string>& docs) {
+    vector <float> data;
+    vector <int32_t> indices;
+    vector <int64_t> indptr;
+    {
+        py::gil_scoped_release release;
+        transform_sparse(docs, data, indices, indptr);
+    }
+
+    // hand each vector over to a numpy array, without copying it
+    auto to_numpy = [](auto& values) {
+        using V = std::decay_t <decltype(values)>;
+        V* owned = new V(std::move(values));
+        py::capsule owner(owned, [](void* pointer) {delete (V*)pointer;});
+        return py::array_t <typename V::value_type>(owned->size(), owned->data(), owner);
+    };
+    return py::make_tuple(to_numpy(data), to_numpy(indices), to_numpy(indptr));
+}
+
+py::dict VHash::stats_dict() const {
+    py::dict seconds, counts;
+    for (size_t stage = 0; stage < (size_t)Stats::Stage::size; stage++) {
+        seconds[Stats::stage_names[stage]] = _stats.seconds((Stats::Stage)stage);
+    }
+    for (size_t counter = 0; counter < (size_t)Stats::Counter::size; counter++) {
+        counts[Stats::counter_names[counter]] = _stats.count((Stats::Counter)counter);
+    }
+    py::dict out;
+    out["enabled"] = Stats::enabled;
+    out["seconds"] = seconds;
+    out["counts"] = counts;
+    out["latency_histogram"] = _stats.latency_histogram();
+    return out;
+}
+#endif
+
+#ifndef __CXX_TESTING__
+py::bytes VHash::__get_state__(const vhash::VHash &v) {
+    auto guard = _lock_without_gil <std::shared_lock <std::shared_mutex>>(v._lock.mutex);
+    std::ostringstream stream;
+    v._write(stream);
+    return py::bytes(stream.str());
+}
+
+VHash VHash::__set_state__(const py::bytes& state) {
+    files::MappedReader reader = files::MappedReader::from_bytes(string(state));
+    return _read(reader, "pickled state");
+}
 #endif
 
 void VHash::_test() {
@@ -177,37 +622,168 @@ void VHash::_test() {
     _test_vectorization();
     _test_transform();
     _test_null();
+    _test_refit();
+    _test_intern_words();
+    _test_parallel_transform();
+    _test_parallel_fit();
+    _test_postings();
+    _test_sparse_vectorization();
+    _test_single_scan();
+    _test_memory_budget();
+    _test_partial_fit();
+    _test_files();
+    _test_save_load();
+    _test_stats();
+    _test_memory_usage();
+    _test_quantize();
+    _test_feature_capping();
+    _test_transform_sparse();
+    _test_concurrency();
+}
+
+void VHash::_fit(
+    const vector <string_view>& docs,
+    const vector <size_t>& labels,
+    Scan& scan
+) {
+    // downsample docs
+    _num_docs = maths::min(vector <size_t>{docs.size(), _downsample_to});
+    scan.scanned = manip::rand_select(docs.size(), _num_docs);
+
+    // create table (keeping each doc's phrases, unless under a memory budget)
+    _create_table(docs, scan);
+    if (!_memory_budget) {_resolve(docs, scan);}
+
+    // compute weights
+    _compute_weights(docs, labels, scan);
+
+    // make features
+    _make_features(docs, scan);
 }
 
 void VHash::_create_table(
-    const vector <string>& docs,
-    const vector <char>& insert_me
+    const vector <string_view>& docs,
+    Scan& scan
 ) {
+    _start_counting();
+    if (!_memory_budget) {scan.hashes.assign(docs.size(), {});}
+    _count_docs(docs, scan.scanned, nullptr, _memory_budget? nullptr: &scan.hashes);
+    _finish_counting();
+    _counter = Counter();
+}
 
-    // insert documents
-    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+void VHash::_start_counting(const bool& doc_freqs) {
 
-        // insert document, if preselected
-        if (insert_me[doc_num]) {
+    // start from an empty table
+    _counter = Counter();
 
-            // Get phrases contained in document
-            vector <string> phrases = _break_into_phrases(docs[doc_num]);
+    // use a quarter of the memory budget for sketches (split evenly between
+    // counts and document frequencies), and the rest for the table (and
+    // shards)
+    if (_memory_budget) {
+        _counter.sketch = CountMin(_memory_budget / (doc_freqs? 8: 4));
+        if (doc_freqs) {_counter.doc_freq_sketch = CountMin(_memory_budget / 8);}
+        _counter.budget = _memory_budget - _memory_budget / 4;
+        if (parallel::num_threads(_n_jobs) > 1) {
+            _counter.budget -= _memory_budget / 4;
+        }
+    }
+}
 
-            // Add each phrase to table
-            for (const string& phrase: phrases) {
-                auto element = _table.find(phrase);
-                if (element == _table.end()) {
-                    _table.insert(std::pair <string, size_t>(phrase, 1));
-                } else {
-                    (*element).second++;
+void VHash::_count_docs(
+    const vector <string_view>& docs,
+    const vector <char>& selected,
+    const vector <size_t>* labels,
+    vector <vector <uint64_t>>* hashes
+) {
+    // per-thread buffers, and shards to count into (if running in parallel)
+    size_t num_threads = parallel::num_threads(_n_jobs);
+    vector <Tokenizer> tokenizers(num_threads, Tokenizer(*this));
+    vector <Counter> shards(num_threads > 1? num_threads: 0);
+    for (Counter& shard: shards) {
+        shard.set_num_classes(_counter.num_classes);
+    }
+    vector <vector <uint64_t>> unused_hashes(num_threads);
+
+    // give shards a quarter of the memory budget
+    size_t shard_budget = _memory_budget && !shards.empty()? _memory_budget / 4 / shards.size(): 0;
+    std::mutex merging;
+
+    // insert documents, one evaluation step at a time (by position in stream)
+    size_t step = _live_evaluation_step? _live_evaluation_step: docs.size();
+    size_t first = _counter.num_docs;
+    for (size_t block_start = 0; block_start < docs.size();) {
+        size_t block_end = (first + block_start) / step * step + step - first;
+        if (block_end > docs.size()) {block_end = docs.size();}
+
+        // get preselected docs in block, and split them into chunks
+        vector <size_t> doc_nums, doc_sizes;
+        for (size_t doc_num = block_start; doc_num < block_end; doc_num++) {
+            if (!selected[doc_num]) {continue;}
+            doc_nums.push_back(doc_num);
+            doc_sizes.push_back(docs[doc_num].size() + 1);
+        }
+        vector <size_t> chunks = parallel::split(doc_sizes, num_threads);
+
+        // count phrases (in each thread's shard)
+        parallel::for_each(chunks.size() - 1, num_threads, [&](const size_t& chunk, const size_t& thread) {
+            Counter& counter = shards.empty()? _counter: shards[thread];
+            for (size_t g = chunks[chunk]; g < chunks[chunk + 1]; g++) {
+                size_t doc_num = doc_nums[g];
+                _count(
+                    docs[doc_num],
+                    tokenizers[thread],
+                    counter,
+                    hashes? (*hashes)[doc_num]: unused_hashes[thread],
+                    labels? (*labels)[doc_num]: 0
+                );
+                counter.fit_budget();
+
+                // merge shard early, if it's over budget
+                if (shard_budget && counter.memory() > shard_budget) {
+                    std::lock_guard <std::mutex> guard(merging);
+                    VHASH_STATS_TIME(_stats, merge);
+                    _merge(counter);
+                    counter.clear();
                 }
             }
+        });
+
+        // merge shards into table
+        for (Counter& shard: shards) {
+            VHASH_STATS_TIME(_stats, merge);
+            _merge(shard);
+            shard.clear();
+        }
+
+        // Knock table down to a reasonable size (in a single pass)
+        _counter.num_docs += block_end - block_start;
+        if (_live_evaluation_step && _counter.num_docs % _live_evaluation_step == 0) {
+            if (_counter.phrases.size() > _max_num_phrases) {
+                VHASH_STATS_TIME(_stats, prune);
+                VHASH_STATS_ONLY(size_t num_phrases = _counter.phrases.size();)
+                _counter.remove_infreq(_counter.threshold(_max_num_phrases));
+                VHASH_STATS_ADD(_stats, prunes, 1);
+                VHASH_STATS_ADD(_stats, phrases_pruned, num_phrases - _counter.phrases.size());
+            }
         }
+        block_start = block_end;
+    }
+}
 
-        // Knock table down to a reasonable size
-        if ((doc_num + 1) % _live_evaluation_step == 0) {
-            for (size_t remove_thresh = 2; _table.size() > _max_num_phrases; remove_thresh++) {
-                _remove_infreq(remove_thresh);
+void VHash::_finish_counting() {
+
+    // get final estimate of each candidate's count (and document
+    // frequencies, which can't exceed the number of docs in each class)
+    if (!_counter.sketch.empty()) {
+        for (size_t index = 0; index < _counter.phrases.size(); index++) {
+            uint64_t h = hash(_counter.phrases.key(index));
+            _counter.counts[index] = _counter.sketch.estimate(h);
+            if (_counter.doc_freq_sketch.empty()) {continue;}
+            for (size_t class_num = 0; class_num < _counter.num_classes; class_num++) {
+                size_t& freq = _counter.doc_freq[index * _counter.num_classes + class_num];
+                freq += _counter.doc_freq_sketch.estimate(Counter::class_hash(h, class_num));
+                if (freq > _counter.docs_in_class[class_num]) {freq = _counter.docs_in_class[class_num];}
             }
         }
     }
@@ -218,188 +794,754 @@ void VHash::_create_table(
             _min_phrase_occurrence:
             _min_phrase_occurrence * _num_docs
     );
-    _remove_infreq(final_size);
+    {
+        VHASH_STATS_TIME(_stats, prune);
+        VHASH_STATS_ONLY(size_t num_phrases = _counter.phrases.size();)
+        _counter.remove_infreq(final_size);
+        VHASH_STATS_ADD(_stats, prunes, 1);
+        VHASH_STATS_ADD(_stats, phrases_pruned, num_phrases - _counter.phrases.size());
+    }
 
-    // assign an index to each table entry
-    _assign_indices();
+    // drop words that aren't part of any remaining phrase
+    if (_intern_words) {
+        _remove_unused_words();
+    }
+
+    // freeze tables for lookups
+    _table = FrozenTable(_counter.phrases);
+    _words = FrozenTable(_counter.words);
+}
+
+void VHash::_resolve(
+    const vector <string_view>& docs,
+    Scan& scan
+) const {
+
+    // keys are found by the hashes recorded while counting (which are
+    // unseeded, so are computed again if the table had to seed its keys)
+    const FrozenTable& keys = _intern_words? _words: _table;
+    uint64_t seed = keys.seed();
+
+    // split scanned docs into chunks
+    size_t num_threads = parallel::num_threads(_n_jobs);
+    vector <size_t> doc_nums, doc_sizes;
+    for (size_t doc_num = 0; doc_num < scan.scanned.size(); doc_num++) {
+        if (!scan.scanned[doc_num]) {continue;}
+        doc_nums.push_back(doc_num);
+        doc_sizes.push_back(scan.hashes[doc_num].size() + 1);
+    }
+    vector <size_t> chunks = parallel::split(doc_sizes, num_threads);
+
+    // resolve each doc's hashes
+    scan.indices.assign(scan.scanned.size(), {});
+    vector <Tokenizer> tokenizers(num_threads, Tokenizer(*this));
+    parallel::for_each(chunks.size() - 1, num_threads, [&](const size_t& chunk, const size_t& thread) {
+        Tokenizer& tokenizer = tokenizers[thread];
+        for (size_t g = chunks[chunk]; g < chunks[chunk + 1]; g++) {
+            size_t doc_num = doc_nums[g];
+            vector <uint64_t>& hashes = scan.hashes[doc_num];
+
+            // find entry of each key (in the order hashes were recorded),
+            // confirming it by its bytes, so keys with colliding hashes
+            // aren't confused
+            vector <uint32_t>& found = _intern_words? tokenizer.ids: tokenizer.indices;
+            found.clear();
+            size_t key_num = 0;
+            auto resolve = [&](const string_view& key) {
+                uint64_t h = seed? hash(key, seed): hashes[key_num];
+                key_num++;
+                size_t entry = keys.find_hash(h);
+                if (entry != FrozenTable::npos && keys.key(entry) == key) {
+                    found.push_back(entry);
+                } else if (_intern_words) {
+                    found.push_back(Tokenizer::unknown);
+                }
+            };
+            tokenizer.phrases.parse(docs[doc_num]);
+            if (_intern_words) {
+                for (size_t word_num = 0; word_num < tokenizer.phrases.num_words(); word_num++) {
+                    resolve(tokenizer.phrases.word(word_num));
+                }
+            } else {
+                tokenizer.phrases.for_each(resolve);
+            }
+
+            // get phrases from words, or sort phrases
+            if (_intern_words) {
+                _lookup(tokenizer);
+            } else {
+                std::sort(found.begin(), found.end());
+            }
+
+            // keep indices, and free hashes
+            scan.indices[doc_num] = tokenizer.indices;
+            vector <uint64_t>().swap(hashes);
+        }
+    });
+    scan.hashes.clear();
 }
 
 void VHash::_compute_weights(
-    const vector <string>& docs,
+    const vector <string_view>& docs,
     const vector <size_t>& labels,
-    const vector <char>& insert_me
+    const Scan& scan
 ) {
-    // resize weights
-    _weights = vector <float>(_table.size());
-
     // get meta-data
     size_t num_classes = maths::max(labels) + 1;
 
     // get count of number of docs in each class
     vector <size_t> docs_in_class(num_classes, 0);
-    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
-        if (!insert_me[doc_num]) {continue;}
+    for (size_t doc_num = 0; doc_num < scan.scanned.size(); doc_num++) {
+        if (!scan.scanned[doc_num]) {continue;}
         docs_in_class[labels[doc_num]]++;
     }
 
-    // get document frequency for each phrase
-    vector <vector <size_t>> doc_freq(_table.size(), vector <size_t>(num_classes, 0));
-    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
-
-        // check if document is being used (downsampling)
-        if (!insert_me[doc_num]) {continue;}
-
-        // get phrases
-        vector <string> phrases = _break_into_phrases(docs[doc_num]);
-        
-        // count each phrase, once for each doc
-        vector <char> in_doc(_table.size(), 0);
-        for (const string& phrase: phrases) {
-
-            // find element in table, skip if DNE
-            auto element = _table.find(phrase);
-            if (element == _table.end()) {continue;}
-
-            // get phrase index
-            size_t phrase_index = element->second;
-
-            // check if term has already been counted for this doc
-            if (in_doc[phrase_index]) {continue;}
-            in_doc[phrase_index] = true;
-
-            // increment count
-            doc_freq[phrase_index][labels[doc_num]]++;
-        }
+    // get docs being used (downsampling), and split them into chunks
+    size_t num_threads = parallel::num_threads(_n_jobs);
+    vector <size_t> doc_nums, doc_sizes;
+    for (size_t doc_num = 0; doc_num < scan.scanned.size(); doc_num++) {
+        if (!scan.scanned[doc_num]) {continue;}
+        doc_nums.push_back(doc_num);
+        doc_sizes.push_back((scan.kept(doc_num)? scan.indices[doc_num].size(): docs[doc_num].size()) + 1);
     }
-
-    // compute phrase weights
-    for (size_t phrase_index = 0; phrase_index < _table.size(); phrase_index++) {
-
-        // get overall document frequency
-        float overall_doc_freq = maths::sum(doc_freq[phrase_index]);
-
-        // get expected occurrence for each class, if phrases were evenly distributed
-        float expected_occurrence = overall_doc_freq / _num_docs;
-
-        // add in contributing term from each class
-        for (size_t class_num = 0; class_num < num_classes; class_num++) {
-            if (!docs_in_class[class_num]) {continue;}
-            float actual_occurrence = doc_freq[phrase_index][class_num] / (float)docs_in_class[class_num];
-            float difference_from_expectation = (expected_occurrence - actual_occurrence) / expected_occurrence;
-            _weights[phrase_index] += pow(difference_from_expectation, 2);
+    vector <size_t> chunks = parallel::split(doc_sizes, num_threads);
+
+    // get document frequency for each phrase (doc_freq[phrase_index * num_classes + class_num])
+    vector <std::atomic <size_t>> doc_freq(_table.size() * num_classes);
+    vector <Tokenizer> tokenizers(num_threads, Tokenizer(*this));
+    parallel::for_each(chunks.size() - 1, num_threads, [&](const size_t& chunk, const size_t& thread) {
+        for (size_t g = chunks[chunk]; g < chunks[chunk + 1]; g++) {
+            size_t doc_num = doc_nums[g];
+
+            // find phrases (unless kept from scanning)
+            bool kept = scan.kept(doc_num);
+            if (!kept) {_find_indices(docs[doc_num], tokenizers[thread]);}
+            const vector <uint32_t>& indices = kept? scan.indices[doc_num]: tokenizers[thread].indices;
+
+            // count each phrase, once for each doc
+            for (size_t h = 0; h < indices.size(); h++) {
+                if (h && indices[h] == indices[h - 1]) {continue;}
+                doc_freq[indices[h] * num_classes + labels[doc_num]].fetch_add(1, std::memory_order_relaxed);
+            }
         }
-
-        // take sqrt to make euclidean
-        _weights[phrase_index] = sqrt(_weights[phrase_index]);
-    }
+    });
+    // compute weights
+    _compute_weights(docs_in_class, doc_freq);
 }
 
 void VHash::_make_features(
-    const vector <string>& docs
+    const vector <string_view>& docs,
+    const Scan& scan
 ) {
     // initialize features vector
-    _features = vector <Sparse>(maths::min(vector <size_t>{docs.size(), _num_features}));
+    _features_size = maths::min(vector <size_t>{docs.size(), _num_features});
+    vector <Sparse> features(_features_size);
 
     // select features
-    vector <char> use_doc = manip::rand_select(docs.size(), _features.size());
+    vector <char> use_doc = manip::rand_select(docs.size(), _features_size);
+    vector <size_t> doc_nums;
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+        if (use_doc[doc_num]) {doc_nums.push_back(doc_num);}
+    }
 
-    // vectorize documents to create features
-    for (size_t doc_num = 0, feature_count = 0; doc_num < docs.size(); doc_num++) {
-        if (!use_doc[doc_num]) {continue;}
-        _features[feature_count++] = 
-            _vectorize(docs[doc_num])
+    // vectorize documents to create features (reusing scanned docs), and cap
+    // their terms
+    size_t num_threads = parallel::num_threads(_n_jobs);
+    vector <Tokenizer> tokenizers(num_threads, Tokenizer(*this));
+    vector <float> errors(_features_size);
+    parallel::for_each(_features_size, num_threads, [&](const size_t& feature_num, const size_t& thread) {
+        size_t doc_num = doc_nums[feature_num];
+        features[feature_num] = (
+            scan.kept(doc_num)?
+                _vectorize(scan.indices[doc_num]):
+                _vectorize(docs[doc_num], tokenizers[thread])
+            )
             .multiply(_weights, true)
             .normalize()
         ;
+        errors[feature_num] = _cap_feature(features[feature_num]);
+    });
+    _feature_errors = std::move(errors);
+
+    // count postings of each phrase
+    vector <uint64_t> postings_start(_table.size() + 1, 0);
+    for (const Sparse& feature: features) {
+        for (const size_t& index: feature.indices) {
+            postings_start[index + 1]++;
+        }
     }
-}
-
-vector <string> VHash::_break_into_phrases(const string& doc) const {
-    vector <string> out;
-    for (size_t phrase_len = _smallest_ngram; phrase_len <= _largest_ngram; phrase_len++) {
-        vector <string> phrases = text::get_phrases(doc, phrase_len);
-        out.insert(out.end(), phrases.begin(), phrases.end());
+    for (size_t index = 0; index < _table.size(); index++) {
+        postings_start[index + 1] += postings_start[index];
     }
-    return out;
-}
 
-void VHash::_remove_infreq(const size_t& thresh) {
-    if (!thresh) {return;}
-    for (auto it = _table.begin(); it != _table.end();) {
-        if ((*it).second < thresh) {
-            it = _table.erase(it);
-        } else {
-            it++;
+    // fill postings (in feature order)
+    vector <uint32_t> postings_feature(postings_start.back());
+    vector <float> postings_value(postings_start.back());
+    vector <uint64_t> fill(postings_start.begin(), postings_start.end() - 1);
+    for (size_t feature_num = 0; feature_num < _features_size; feature_num++) {
+        const Sparse& feature = features[feature_num];
+        for (size_t g = 0; g < feature.num_nonzero(); g++) {
+            uint64_t p = fill[feature.indices[g]]++;
+            postings_feature[p] = feature_num;
+            postings_value[p] = feature.values[g];
         }
     }
+    _postings_start = std::move(postings_start);
+    _postings_feature = std::move(postings_feature);
+    _postings_value = std::move(postings_value);
+    _quantize_features();
 }
 
-void VHash::_assign_indices() {
-    size_t index = 0;
-    for (auto it = _table.begin(); it != _table.end(); it++) {
-        (*it).second = index++;
+float VHash::_cap_feature(Sparse& feature) const {
+
+    // get number of terms allowed
+    size_t size = feature.num_nonzero();
+    size_t max_terms = _max_feature_terms && _max_feature_terms < size? _max_feature_terms: size;
+    if (max_terms == size && _feature_mass >= 1) {return 0;}
+
+    // order terms from largest to smallest
+    vector <size_t> order(size);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](const size_t& a, const size_t& b) {
+        return std::abs(feature.values[a]) > std::abs(feature.values[b]);
+    });
+
+    // keep the largest terms, until holding enough of the squared norm
+    double total = 0, kept = 0;
+    for (const float& value: feature.values) {
+        total += value * value;
+    }
+    size_t num_kept = 0;
+    while (num_kept < max_terms && kept < _feature_mass * total) {
+        float value = feature.values[order[num_kept++]];
+        kept += value * value;
+    }
+    if (num_kept == size || !kept) {return 0;}
+
+    // renormalize kept terms (in index order) to the feature's norm
+    std::sort(order.begin(), order.begin() + num_kept);
+    float scale = sqrt(total / kept);
+    Sparse capped;
+    capped.max_index = feature.max_index;
+    double error = 0;
+    for (size_t g = 0, next = 0; g < size; g++) {
+        float value = feature.values[g];
+        if (next < num_kept && order[next] == g) {
+            capped.indices.push_back(feature.indices[g]);
+            capped.values.push_back(value * scale);
+            error += (value * scale - value) * (value * scale - value);
+            next++;
+        }
+        else {error += value * value;}
     }
+    feature = std::move(capped);
+    return sqrt(error);
 }
 
-Sparse VHash::_vectorize(const string& doc) {
-    
-    // get phases
-    vector <string> phrases = _break_into_phrases(doc);
+void VHash::_quantize_features() {
+
+    // clear previous quantization (in case of refitting)
+    _postings_half = Buffer <uint16_t>();
+    _postings_int8 = Buffer <int8_t>();
+    _feature_scales = Buffer <float>();
+    _weights_half = Buffer <uint16_t>();
+    if (_quantize == Quantize::none) {return;}
 
-    // get counts of each phrase
-    vector <size_t> counts(_table.size(), 0);
-    for (const string& phrase: phrases) {
-        auto element = _table.find(phrase);
-        if (element == _table.end()) {continue;}
-        counts[element->second]++;
+    // weights are kept in half precision (a single int8 scale would zero
+    // the many small weights, skewing documents towards rarer phrases)
+    vector <uint16_t> weights(_weights.size());
+    for (size_t index = 0; index < weights.size(); index++) {
+        weights[index] = quant::to_half(_weights[index]);
     }
+    _weights_half = std::move(weights);
 
-    // convert to sparse
-    Sparse out = Sparse(counts);
+    // half precision
+    if (_quantize == Quantize::fp16) {
+        vector <uint16_t> postings(_postings_value.size());
+        for (size_t p = 0; p < postings.size(); p++) {
+            postings[p] = quant::to_half(_postings_value[p]);
+        }
+        _postings_half = std::move(postings);
+    }
 
-    // take log of non-zero entries
-    for (float& value: out.values) {
-        value = log(1 + value);
+    // int8, scaling values by the largest in each feature
+    else {
+        vector <float> scales(_features_size, 0);
+        for (size_t p = 0; p < _postings_value.size(); p++) {
+            float& scale = scales[_postings_feature[p]];
+            scale = std::max(scale, std::abs(_postings_value[p]) / 127);
+        }
+        for (float& scale: scales) {
+            if (!scale) {scale = 1;}
+        }
+        vector <int8_t> postings(_postings_value.size());
+        for (size_t p = 0; p < postings.size(); p++) {
+            postings[p] = quant::to_int8(_postings_value[p], scales[_postings_feature[p]]);
+        }
+        _postings_int8 = std::move(postings);
+        _feature_scales = std::move(scales);
     }
 
-    // return
-    return out;
+    // drop float values
+    _postings_value = Buffer <float>();
+    _weights = Buffer <float>();
 }
 
-std::pair <vector <string>, vector <size_t>> VHash::_get_test_data() {
-    return std::pair <vector <string>, vector <size_t>>(
-        vector <string> {
-            "hi, my name is Mike",
-            "hi, my name is George",
-            "hello, my name is Mike",
-        },
-        vector <size_t> {0, 1, 0}
-    );
+void VHash::_tokenize(
+    const string_view& doc,
+    Tokenizer& tokenizer,
+    Table* words
+) const {
+    VHASH_STATS_TIME(_stats, tokenize);
+
+    // find phrases
+    tokenizer.phrases.parse(doc);
+    if (!_intern_words) {return;}
+
+    // look up (or assign) id of each word
+    tokenizer.ids.resize(tokenizer.phrases.num_words());
+    if (words) {tokenizer.hashes.resize(tokenizer.ids.size());}
+    for (size_t word_num = 0; word_num < tokenizer.ids.size(); word_num++) {
+        string_view word = tokenizer.phrases.word(word_num);
+        size_t id;
+        if (words) {
+            uint64_t h = hash(word);
+            tokenizer.hashes[word_num] = h;
+            id = words->insert(word, h);
+        } else {
+            id = _words.find(word);
+        }
+        tokenizer.ids[word_num] = id == FrozenTable::npos? Tokenizer::unknown: id;
+    }
 }
 
-void VHash::_test_basic_creation() {
-    auto data = VHash::_get_test_data();
-    VHash vhash = VHash(2).fit(data.first, data.second);
-    assert(vhash._table.size() == 13);
-    assert(vhash._table.find("hi") != vhash._table.end());
-    assert(vhash._table.find("my name") != vhash._table.end());
-    assert(vhash._table.find("my name is") == vhash._table.end());
+void VHash::_find_indices(const string_view& doc, Tokenizer& tokenizer) const {
+    _tokenize(doc, tokenizer);
+    _lookup(tokenizer);
 }
 
-void VHash::_test_min_phrase_occurrence() {
-    auto data = VHash::_get_test_data();
-    VHash vhash = VHash(2, 2).fit(data.first, data.second);
-    assert(vhash._table.size() == 9);
-    assert(vhash._table.find("george") == vhash._table.end());
-    assert(vhash._table.find("is mike") != vhash._table.end());
+void VHash::_lookup(Tokenizer& tokenizer) const {
+    VHASH_STATS_TIME(_stats, lookup);
+
+    // look up phrases
+    vector <uint32_t>& indices = tokenizer.indices;
+    indices.clear();
+    VHASH_STATS_ONLY(uint64_t num_phrases = 0;)
+    _for_each_key(tokenizer, [&](const string_view& phrase) {
+        VHASH_STATS_ONLY(num_phrases++;)
+        size_t index = _table.find(phrase);
+        if (index == FrozenTable::npos) {return;}
+        indices.push_back(index);
+    });
+    VHASH_STATS_ADD(_stats, phrases_generated, num_phrases);
+    VHASH_STATS_ADD(_stats, phrases_found, indices.size());
+    VHASH_STATS_ADD(_stats, phrases_oov, num_phrases - indices.size());
+
+    // sort, so repeats are adjacent
+    std::sort(indices.begin(), indices.end());
 }
 
-void VHash::_test_assigned_indices() {
-    auto data = VHash::_get_test_data();
-    VHash vhash = VHash(2, 2).fit(data.first, data.second);
+string VHash::_key(const string_view& phrase) {
+    if (!_intern_words) {return string(phrase);}
+    Tokenizer tokenizer(*this);
+    _tokenize(phrase, tokenizer);
+    string key;
+    for (const uint32_t& id: tokenizer.ids) {
+        if (id == Tokenizer::unknown) {return "";}
+        key.append((const char*)&id, sizeof(uint32_t));
+    }
+    return key;
+}
+
+string VHash::_phrase(const size_t& index) const {
+    string_view key = _table.key(index);
+    if (!_intern_words) {return string(key);}
+    string phrase;
+    for (size_t pos = 0; pos < key.size(); pos += sizeof(uint32_t)) {
+        uint32_t id;
+        memcpy(&id, &key[pos], sizeof(uint32_t));
+        phrase += (pos? " ": "") + string(_words.key(id));
+    }
+    return phrase;
+}
+
+vector <string_view> VHash::_views(const vector <string>& docs) {
+    return vector <string_view>(docs.begin(), docs.end());
+}
+
+vector <size_t> VHash::_class_labels(const vector <string_view>& labels) {
+
+    // number distinct labels in sorted order
+    vector <string_view> distinct = labels;
+    std::sort(distinct.begin(), distinct.end());
+    distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+
+    // look up each label's number
+    vector <size_t> out(labels.size());
+    for (size_t doc_num = 0; doc_num < labels.size(); doc_num++) {
+        out[doc_num] = std::lower_bound(distinct.begin(), distinct.end(), labels[doc_num]) - distinct.begin();
+    }
+    return out;
+}
+
+void VHash::_count(
+    const string_view& doc,
+    Tokenizer& tokenizer,
+    Counter& counter,
+    vector <uint64_t>& hashes,
+    const size_t& label
+) const {
+
+    // Get phrases contained in document
+    _tokenize(doc, tokenizer, &counter.words);
+    VHASH_STATS_TIME(_stats, count);
+    VHASH_STATS_ADD(_stats, docs_fit, 1);
+    hashes.clear();
+    if (_intern_words) {hashes = tokenizer.hashes;}
+
+    // Add each phrase to table
+    vector <uint32_t>& indices = tokenizer.indices;
+    indices.clear();
+    bool sketch_doc_freqs = counter.num_classes && !counter.doc_freq_sketch.empty();
+    vector <uint64_t>& key_hashes = tokenizer.key_hashes;
+    key_hashes.clear();
+    VHASH_STATS_ONLY(uint64_t num_phrases = 0;)
+    _for_each_key(tokenizer, [&](const string_view& phrase) {
+        VHASH_STATS_ONLY(num_phrases++;)
+        uint64_t h = hash(phrase);
+        if (!_intern_words) {hashes.push_back(h);}
+        size_t index = counter.add(phrase, h, 1);
+        if (counter.num_classes && index != Table::npos) {indices.push_back(index);}
+        if (sketch_doc_freqs && index == Table::npos) {key_hashes.push_back(h);}
+    });
+    VHASH_STATS_ADD(_stats, phrases_generated, num_phrases);
+
+    // count document frequencies (once per phrase in doc), sketching those
+    // of phrases that aren't candidates
+    if (!counter.num_classes) {return;}
+    counter.docs_in_class[label]++;
+    if (sketch_doc_freqs) {
+        std::sort(key_hashes.begin(), key_hashes.end());
+        for (size_t g = 0; g < key_hashes.size(); g++) {
+            if (g && key_hashes[g] == key_hashes[g - 1]) {continue;}
+            counter.doc_freq_sketch.add(Counter::class_hash(key_hashes[g], label));
+        }
+    }
+    std::sort(indices.begin(), indices.end());
+    for (size_t g = 0; g < indices.size(); g++) {
+        if (g && indices[g] == indices[g - 1]) {continue;}
+        counter.doc_freq[indices[g] * counter.num_classes + label]++;
+    }
+}
+
+void VHash::_merge(const Counter& shard) {
+
+    // get id of each of the shard's words
+    vector <uint32_t> word_ids(shard.words.size());
+    for (size_t id = 0; id < shard.words.size(); id++) {
+        word_ids[id] = _counter.words.insert(shard.words.key(id));
+    }
+
+    // add each phrase's count
+    string key;
+    for (size_t index = 0; index < shard.phrases.size(); index++) {
+        string_view phrase = shard.phrases.key(index);
+        if (_intern_words) {
+            key = phrase;
+            _renumber_words(key, word_ids);
+            phrase = key;
+        }
+        uint64_t h = hash(phrase);
+        size_t merged = _counter.add(phrase, h, shard.counts[index]);
+
+        // add document frequencies (to the sketch, if not a candidate)
+        if (merged == Table::npos && !_counter.doc_freq_sketch.empty()) {
+            for (size_t class_num = 0; class_num < _counter.num_classes; class_num++) {
+                size_t freq = shard.doc_freq[index * shard.num_classes + class_num];
+                if (freq) {_counter.doc_freq_sketch.add(Counter::class_hash(h, class_num), freq);}
+            }
+        }
+        if (merged != Table::npos) {
+            for (size_t class_num = 0; class_num < _counter.num_classes; class_num++) {
+                _counter.doc_freq[merged * _counter.num_classes + class_num] += shard.doc_freq[index * shard.num_classes + class_num];
+            }
+        }
+        _counter.fit_budget();
+    }
+    for (size_t class_num = 0; class_num < _counter.num_classes; class_num++) {
+        _counter.docs_in_class[class_num] += shard.docs_in_class[class_num];
+    }
+}
+
+void VHash::_renumber_words(string& key, const vector <uint32_t>& new_ids) {
+    for (size_t pos = 0; pos < key.size(); pos += sizeof(uint32_t)) {
+        uint32_t id;
+        memcpy(&id, &key[pos], sizeof(uint32_t));
+        memcpy(&key[pos], &new_ids[id], sizeof(uint32_t));
+    }
+}
+
+size_t VHash::Counter::add(
+    const string_view& key,
+    const uint64_t& hash,
+    const size_t& count
+) {
+    // exact counts
+    size_t index;
+    if (sketch.empty()) {
+        index = phrases.insert(key, hash);
+        if (index == counts.size()) {
+            counts.push_back(count);
+        } else {
+            counts[index] += count;
+        }
+    }
+
+    // approximate counts: only keep phrases frequent enough to be candidates
+    else {
+        size_t estimate = sketch.add(hash, count);
+        if (estimate < floor) {return Table::npos;}
+        index = phrases.insert(key, hash);
+        if (index == counts.size()) {
+            counts.push_back(estimate);
+        } else {
+            counts[index] = estimate;
+        }
+    }
+
+    // make room for document frequencies
+    if (num_classes) {doc_freq.resize(counts.size() * num_classes, 0);}
+    return index;
+}
+
+void VHash::Counter::set_num_classes(const size_t& num_classes_) {
+
+    // move each phrase's document frequencies into a wider row
+    vector <size_t> widened(counts.size() * num_classes_, 0);
+    for (size_t index = 0; index < counts.size(); index++) {
+        for (size_t class_num = 0; class_num < num_classes; class_num++) {
+            widened[index * num_classes_ + class_num] = doc_freq[index * num_classes + class_num];
+        }
+    }
+    doc_freq = std::move(widened);
+    docs_in_class.resize(num_classes_, 0);
+    num_classes = num_classes_;
+}
+
+size_t VHash::Counter::threshold(const size_t& max_size) const {
+    if (counts.size() <= max_size) {return 1;}
+
+    // find the (max_size + 1)'th largest count
+    vector <size_t> sorted = counts;
+    std::nth_element(sorted.begin(), sorted.begin() + max_size, sorted.end(), std::greater <size_t>());
+    return sorted[max_size] + 1;
+}
+
+void VHash::Counter::remove_infreq(const size_t& thresh) {
+    if (thresh <= 1) {return;}
+
+    // mark phrases to keep
+    vector <char> keep(counts.size());
+    for (size_t index = 0; index < counts.size(); index++) {
+        keep[index] = counts[index] >= thresh;
+    }
+
+    // sketch document frequencies of removed phrases (if sketching them), so
+    // they aren't lost if the phrases are admitted again
+    if (!doc_freq_sketch.empty()) {
+        for (size_t index = 0; index < keep.size(); index++) {
+            if (keep[index]) {continue;}
+            uint64_t h = hash(phrases.key(index));
+            for (size_t class_num = 0; class_num < num_classes; class_num++) {
+                size_t freq = doc_freq[index * num_classes + class_num];
+                if (freq) {doc_freq_sketch.add(class_hash(h, class_num), freq);}
+            }
+        }
+    }
+
+    // remove from table, and compact counts (and document frequencies) to match
+    phrases.filter(keep);
+    size_t num_kept = 0;
+    for (size_t index = 0; index < keep.size(); index++) {
+        if (!keep[index]) {continue;}
+        counts[num_kept] = counts[index];
+        for (size_t class_num = 0; class_num < num_classes; class_num++) {
+            doc_freq[num_kept * num_classes + class_num] = doc_freq[index * num_classes + class_num];
+        }
+        num_kept++;
+    }
+    counts.resize(num_kept);
+    doc_freq.resize(num_kept * num_classes);
+}
+
+void VHash::Counter::shrink() {
+    size_t thresh = threshold(counts.size() / 2);
+    remove_infreq(thresh);
+    if (thresh > floor) {floor = thresh;}
+}
+
+void VHash::_remove_unused_words() {
+
+    // mark words used in any phrase
+    vector <char> used(_counter.words.size(), false);
+    for (size_t index = 0; index < _counter.phrases.size(); index++) {
+        string_view phrase = _counter.phrases.key(index);
+        for (size_t pos = 0; pos < phrase.size(); pos += sizeof(uint32_t)) {
+            uint32_t id;
+            memcpy(&id, &phrase[pos], sizeof(uint32_t));
+            used[id] = true;
+        }
+    }
+
+    // get each word's new id
+    vector <uint32_t> new_ids(_counter.words.size());
+    for (size_t id = 0, num_used = 0; id < _counter.words.size(); id++) {
+        new_ids[id] = num_used;
+        num_used += used[id];
+    }
+    _counter.words.filter(used);
+
+    // rebuild table with new ids (in the same order, so indices don't change)
+    Table phrases;
+    phrases.reserve(_counter.phrases.size());
+    string key;
+    for (size_t index = 0; index < _counter.phrases.size(); index++) {
+        key = _counter.phrases.key(index);
+        _renumber_words(key, new_ids);
+        phrases.insert(key);
+    }
+    _counter.phrases = std::move(phrases);
+}
+
+Sparse VHash::_vectorize(const string_view& doc) {
+    Tokenizer tokenizer(*this);
+    return _vectorize(doc, tokenizer);
+}
+
+Sparse VHash::_vectorize(const string_view& doc, Tokenizer& tokenizer) {
+    _find_indices(doc, tokenizer);
+    return _vectorize(tokenizer.indices);
+}
+
+Sparse VHash::_vectorize(const vector <uint32_t>& indices) const {
+
+    // count runs of each phrase, taking log of counts
+    Sparse out;
+    out.max_index = _table.size();
+    for (size_t start = 0, end = 0; start < indices.size(); start = end) {
+        while (end < indices.size() && indices[end] == indices[start]) {end++;}
+        out.indices.push_back(indices[start]);
+        out.values.push_back(log(1 + end - start));
+    }
+
+    // return
+    return out;
+}
+
+vector <vector <float>> VHash::_transform(
+    const vector <string_view>& docs,
+    const Scan* scan
+) {
+    vector <float> flat(docs.size() * _features_size);
+    _transform(docs, flat.data(), _features_size, scan);
+    vector <vector <float>> out(docs.size());
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+        auto row = flat.begin() + doc_num * _features_size;
+        out[doc_num].assign(row, row + _features_size);
+    }
+    return out;
+}
+
+Sparse VHash::_weigh(const vector <uint32_t>& indices) const {
+    Sparse out;
+    out.max_index = _table.size();
+    out.indices.resize(indices.size());
+    out.values.resize(indices.size());
+    size_t num_nonzero = _weigh(indices, out.indices.data(), out.values.data());
+    out.indices.resize(num_nonzero);
+    out.values.resize(num_nonzero);
+    return out;
+}
+
+void VHash::_scatter(const Sparse& weighted, float* row, int32_t* sums) const {
+
+    // float
+    if (_quantize == Quantize::none) {
+        std::fill(row, row + _features_size, 0);
+        for (size_t g = 0; g < weighted.num_nonzero(); g++) {
+            size_t index = weighted.indices[g];
+            float value = weighted.values[g];
+            for (uint64_t p = _postings_start[index]; p < _postings_start[index + 1]; p++) {
+                row[_postings_feature[p]] += value * _postings_value[p];
+            }
+        }
+    }
+
+    // half precision (widened as read)
+    else if (_quantize == Quantize::fp16) {
+        std::fill(row, row + _features_size, 0);
+        for (size_t g = 0; g < weighted.num_nonzero(); g++) {
+            size_t index = weighted.indices[g];
+            float value = weighted.values[g];
+            for (uint64_t p = _postings_start[index]; p < _postings_start[index + 1]; p++) {
+                row[_postings_feature[p]] += value * quant::from_half(_postings_half[p]);
+            }
+        }
+    }
+
+    // int8 (quantizing the document too, and summing products as integers)
+    else {
+        std::fill(sums, sums + _features_size, 0);
+        float doc_scale = quant::int8_scale(weighted.values.data(), weighted.num_nonzero());
+        for (size_t g = 0; g < weighted.num_nonzero(); g++) {
+            size_t index = weighted.indices[g];
+            int32_t value = quant::to_int8(weighted.values[g], doc_scale);
+            for (uint64_t p = _postings_start[index]; p < _postings_start[index + 1]; p++) {
+                sums[_postings_feature[p]] += value * _postings_int8[p];
+            }
+        }
+        for (size_t feature_num = 0; feature_num < _features_size; feature_num++) {
+            row[feature_num] = sums[feature_num] * doc_scale * _feature_scales[feature_num];
+        }
+    }
+}
+
+std::pair <vector <string>, vector <size_t>> VHash::_get_test_data() {
+    return std::pair <vector <string>, vector <size_t>>(
+        vector <string> {
+            "hi, my name is Mike",
+            "hi, my name is George",
+            "hello, my name is Mike",
+        },
+        vector <size_t> {0, 1, 0}
+    );
+}
+
+void VHash::_test_basic_creation() {
+    auto data = VHash::_get_test_data();
+    VHash vhash = VHash(2).fit(data.first, data.second);
+    assert(vhash._table.size() == 13);
+    assert(vhash._table.find("hi") != FrozenTable::npos);
+    assert(vhash._table.find("my name") != FrozenTable::npos);
+    assert(vhash._table.find("my name is") == FrozenTable::npos);
+}
+
+void VHash::_test_min_phrase_occurrence() {
+    auto data = VHash::_get_test_data();
+    VHash vhash = VHash(2, 2).fit(data.first, data.second);
+    assert(vhash._table.size() == 9);
+    assert(vhash._table.find("george") == FrozenTable::npos);
+    assert(vhash._table.find("is mike") != FrozenTable::npos);
+}
+
+void VHash::_test_assigned_indices() {
+    auto data = VHash::_get_test_data();
+    VHash vhash = VHash(2, 2).fit(data.first, data.second);
     vector <char> index_assigned(vhash._table.size(), false);
-    for (auto it = vhash._table.begin(); it != vhash._table.end(); it++) {
-        index_assigned[(*it).second] = true;
+    for (size_t index = 0; index < vhash._table.size(); index++) {
+        size_t found = vhash._table.find(vhash._table.key(index));
+        assert(found == index);
+        index_assigned[found] = true;
     }
     assert((size_t)maths::sum(index_assigned) == index_assigned.size());
 }
@@ -407,9 +1549,9 @@ void VHash::_test_assigned_indices() {
 void VHash::_test_weights() {
     auto data = VHash::_get_test_data();
     VHash vhash = VHash().fit(data.first, data.second);
-    assert(vhash._weights[vhash._table.find("mike")->second] > vhash._weights[vhash._table.find("hi")->second]);
-    assert(vhash._weights[vhash._table.find("george")->second] > vhash._weights[vhash._table.find("mike")->second]);
-    assert(maths::isclose(vhash._weights[vhash._table.find("name")->second], 0));
+    assert(vhash._weights[vhash._table.find("mike")] > vhash._weights[vhash._table.find("hi")]);
+    assert(vhash._weights[vhash._table.find("george")] > vhash._weights[vhash._table.find("mike")]);
+    assert(maths::isclose(vhash._weights[vhash._table.find("name")], 0));
 }
 
 void VHash::_test_vectorization() {
@@ -448,6 +1590,14 @@ void VHash::_test_transform() {
     assert(doc_vecs[2][0] > doc_vecs[2][1]);
 }
 
+void VHash::_test_refit() {
+    auto data = VHash::_get_test_data();
+    VHash vhash = VHash(2);
+    vhash.fit(data.first, data.second);
+    vhash.fit(data.first, data.second);
+    assert(vhash._table.size() == 13);
+}
+
 void VHash::_test_null() {
     auto data = VHash::_get_test_data();
     data.first[1] = "";
@@ -457,3 +1607,895 @@ void VHash::_test_null() {
     data.first[1] = "";
     vhash.transform(data.first);
 }
+
+void VHash::_test_intern_words() {
+
+    // check table contents
+    auto data = VHash::_get_test_data();
+    VHash vhash = VHash(2, 1E-3, 1000, 1E6, 100E3, 10E3, 1, true).fit(data.first, data.second);
+    assert(vhash._table.size() == 13);
+    assert(vhash._words.size() == 7);
+    assert(vhash._table.find(vhash._key("hi")) != FrozenTable::npos);
+    assert(vhash._table.find(vhash._key("my name")) != FrozenTable::npos);
+    assert(vhash._table.find(vhash._key("my name is")) == FrozenTable::npos);
+    assert(vhash._key("hi").size() == sizeof(uint32_t));
+    assert(vhash._key("unseen").empty());
+
+    // check that unused words are dropped
+    vhash = VHash(2, 2, 1000, 1E6, 100E3, 10E3, 1, true).fit(data.first, data.second);
+    assert(vhash._table.size() == 9);
+    assert(vhash._words.find("george") == FrozenTable::npos);
+    assert(vhash._words.find("hello") == FrozenTable::npos);
+
+    // check that transforms match
+    VHash interned = VHash(3, 1E-3, 1000, 1E6, 100E3, 10E3, 1, true).fit(data.first, data.second);
+    VHash plain = VHash().fit(data.first, data.second);
+    vector <vector <float>> interned_vecs = interned.transform(data.first);
+    vector <vector <float>> plain_vecs = plain.transform(data.first);
+    for (size_t doc_num = 0; doc_num < plain_vecs.size(); doc_num++) {
+        for (size_t feature_num = 0; feature_num < plain_vecs[doc_num].size(); feature_num++) {
+            assert(maths::isclose(interned_vecs[doc_num][feature_num], plain_vecs[doc_num][feature_num]));
+        }
+    }
+    assert(maths::isclose(interned.transform({"hi george unseen"})[0][1], plain.transform({"hi george unseen"})[0][1]));
+}
+
+vector <string> VHash::_get_many_test_docs(const size_t& num_docs) {
+    vector <string> docs(num_docs);
+    for (size_t doc_num = 0; doc_num < num_docs; doc_num++) {
+        size_t num_words = 1 + doc_num % 13;
+        for (size_t word_num = 0; word_num < num_words; word_num++) {
+            docs[doc_num] += "word" + std::to_string((doc_num * 7 + word_num * word_num) % 37) + " ";
+        }
+    }
+    return docs;
+}
+
+void VHash::_test_parallel_transform() {
+
+    // fit model
+    vector <string> docs = _get_many_test_docs(20000);
+    vector <size_t> labels(docs.size());
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+        labels[doc_num] = doc_num % 3;
+    }
+    VHash vhash = VHash(3, 1E-3, 20).fit(docs, labels);
+
+    // transform sequentially, and in parallel
+    vector <vector <float>> sequential = vhash.transform(docs);
+    vhash._n_jobs = 4;
+    vector <vector <float>> parallel = vhash.transform(docs);
+
+    // results should be identical
+    assert(sequential.size() == parallel.size());
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+        assert(sequential[doc_num] == parallel[doc_num]);
+    }
+}
+
+void VHash::_test_parallel_fit() {
+
+    // make data
+    vector <string> docs = _get_many_test_docs(20000);
+    vector <size_t> labels(docs.size());
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+        labels[doc_num] = doc_num % 3;
+    }
+
+    // check for both types of keys
+    for (bool intern_words: {false, true}) {
+
+        // fit sequentially, and in parallel (with live evaluations)
+        srand(0);
+        VHash sequential = VHash(3, 1E-3, 20, 500, 100E3, 1000, 1, intern_words, 1).fit(docs, labels);
+        srand(0);
+        VHash parallel = VHash(3, 1E-3, 20, 500, 100E3, 1000, 1, intern_words, 4).fit(docs, labels);
+
+        // check tables contain the same phrases, with the same weights
+        assert(sequential._table.size() == parallel._table.size());
+        assert(sequential._words.size() == parallel._words.size());
+        for (size_t index = 0; index < sequential._table.size(); index++) {
+            size_t parallel_index = parallel._table.find(parallel._key(sequential._phrase(index)));
+            assert(parallel_index != FrozenTable::npos);
+            assert(maths::isclose(sequential._weights[index], parallel._weights[parallel_index]));
+        }
+
+        // check transforms match
+        vector <vector <float>> sequential_vecs = sequential.transform(docs);
+        vector <vector <float>> parallel_vecs = parallel.transform(docs);
+        for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+            for (size_t feature_num = 0; feature_num < sequential_vecs[doc_num].size(); feature_num++) {
+                assert(maths::isclose(sequential_vecs[doc_num][feature_num], parallel_vecs[doc_num][feature_num]));
+            }
+        }
+    }
+
+    // zero jobs throws
+    bool thrown = false;
+    try {
+        VHash(3, 1E-3, 20, 1E6, 100E3, 10E3, 1, false, 0);
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+void VHash::_test_postings() {
+
+    // make data and train model
+    auto data = VHash::_get_test_data();
+    VHash vhash = VHash().fit(data.first, data.second);
+
+    // check structure
+    assert(vhash._postings_start.size() == vhash._table.size() + 1);
+    assert(vhash._postings_start.back() == vhash._postings_feature.size());
+    assert(vhash._postings_start.back() == vhash._postings_value.size());
+    vector <float> squared_norms(vhash._features_size, 0);
+    for (size_t index = 0; index < vhash._table.size(); index++) {
+        uint64_t start = vhash._postings_start[index], end = vhash._postings_start[index + 1];
+        for (uint64_t p = start; p < end; p++) {
+            assert(p == start || vhash._postings_feature[p - 1] < vhash._postings_feature[p]);
+            squared_norms[vhash._postings_feature[p]] += vhash._postings_value[p] * vhash._postings_value[p];
+        }
+    }
+
+    // each feature is normalized
+    for (const float& squared_norm: squared_norms) {
+        assert(maths::isclose(squared_norm, 1));
+    }
+
+    // "mike" is in two docs (and every doc is a feature)
+    size_t index = vhash._table.find("mike");
+    assert(vhash._postings_start[index + 1] - vhash._postings_start[index] == 2);
+}
+
+void VHash::_test_sparse_vectorization() {
+
+    // fit model
+    vector <string> docs = _get_many_test_docs(1000);
+    vector <size_t> labels(docs.size());
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+        labels[doc_num] = doc_num % 3;
+    }
+    VHash vhash = VHash(3, 1E-3, 20).fit(docs, labels);
+
+    // compare against dense counts
+    for (size_t doc_num = 0; doc_num < 100; doc_num++) {
+        Tokenizer tokenizer(vhash);
+        vhash._tokenize(docs[doc_num], tokenizer);
+        vector <size_t> counts(vhash._table.size(), 0);
+        vhash._for_each_key(tokenizer, [&](const string_view& phrase) {
+            size_t index = vhash._table.find(phrase);
+            if (index != FrozenTable::npos) {counts[index]++;}
+        });
+        Sparse expected = Sparse(counts);
+        Sparse sparse = vhash._vectorize(docs[doc_num] + " unseen words");
+        assert(sparse.max_index == expected.max_index);
+        assert(sparse.indices == expected.indices);
+        for (size_t g = 0; g < expected.num_nonzero(); g++) {
+            assert(maths::isclose(sparse.values[g], log(1 + expected.values[g])));
+        }
+    }
+}
+
+void VHash::_test_single_scan() {
+
+    // make data
+    vector <string> docs = _get_many_test_docs(5000);
+    vector <size_t> labels(docs.size());
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+        labels[doc_num] = doc_num % 3;
+    }
+
+    // check for both types of keys (downsampling, so some docs aren't scanned)
+    for (bool intern_words: {false, true}) {
+        VHash vhash = VHash(3, 1E-3, 20, 1E6, 3000, 1000, 1, intern_words, 2);
+
+        // scanned docs match tokenized docs
+        Scan scan;
+        vhash._fit(_views(docs), labels, scan);
+        assert(scan.hashes.empty());
+        for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+            if (!scan.scanned[doc_num]) {continue;}
+            Tokenizer tokenizer(vhash);
+            vhash._find_indices(docs[doc_num], tokenizer);
+            assert(scan.indices[doc_num] == tokenizer.indices);
+        }
+
+        // fit_transform matches fit, then transform
+        srand(1);
+        vector <vector <float>> fit_transformed = vhash.fit_transform(docs, labels);
+        srand(1);
+        vector <vector <float>> transformed = vhash.fit(docs, labels).transform(docs);
+        for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+            for (size_t feature_num = 0; feature_num < transformed[doc_num].size(); feature_num++) {
+                assert(maths::isclose(fit_transformed[doc_num][feature_num], transformed[doc_num][feature_num]));
+            }
+        }
+
+        // keys whose hashes collide with a table key's aren't confused with
+        // it (recording the first key's hash for each key of a doc that
+        // isn't in the table)
+        vector <string> collided = docs;
+        collided.push_back(docs[0] + " xyzzy plugh");
+        vector <string_view> views = _views(collided);
+        scan = Scan();
+        scan.scanned.assign(collided.size(), true);
+        vhash._create_table(views, scan);
+        const FrozenTable& keys = intern_words? vhash._words: vhash._table;
+        Tokenizer tokenizer(vhash);
+        tokenizer.phrases.parse(collided.back());
+        size_t key_num = 0, num_forged = 0;
+        auto forge = [&](const string_view& key) {
+            if (keys.find(key) == FrozenTable::npos) {
+                scan.hashes.back()[key_num] = hash(keys.key(0));
+                num_forged++;
+            }
+            key_num++;
+        };
+        if (intern_words) {
+            for (size_t word_num = 0; word_num < tokenizer.phrases.num_words(); word_num++) {
+                forge(tokenizer.phrases.word(word_num));
+            }
+        } else {
+            tokenizer.phrases.for_each(forge);
+        }
+        assert(num_forged > 0);
+        vhash._resolve(views, scan);
+        vhash._find_indices(collided.back(), tokenizer);
+        assert(scan.indices.back() == tokenizer.indices);
+    }
+}
+
+void VHash::_test_memory_budget() {
+
+    // count 50 frequent keys (~570 times each) among ~170k unique keys
+    Counter counter;
+    counter.sketch = CountMin(1 << 14);
+    counter.budget = 1 << 15;
+    for (size_t g = 0; g < 200000; g++) {
+        string key = "key " + std::to_string(g % 7? g: g % 50);
+        counter.add(key, hash(key), 1);
+        counter.fit_budget();
+        assert(counter.memory() <= counter.budget);
+    }
+
+    // frequent keys are kept, and never undercounted
+    for (size_t g = 0; g < 50; g++) {
+        size_t index = counter.phrases.find("key " + std::to_string(g));
+        assert(index != Table::npos);
+        assert(counter.counts[index] >= 200000 / 7 / 50);
+    }
+
+    // make docs with skewed word frequencies (spelling word numbers in letters)
+    srand(0);
+    vector <string> docs(5000);
+    vector <size_t> labels(docs.size());
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+        for (size_t word_num = 0; word_num < 20; word_num++) {
+            size_t word = rand() % 1000 * (rand() % 1000) / 1000;
+            docs[doc_num] += string("w") + char('a' + word / 100) + char('a' + word / 10 % 10) + char('a' + word % 10) + " ";
+        }
+        labels[doc_num] = doc_num % 2;
+    }
+
+    // get exact count of each phrase
+    VHash exact = VHash(2, 20, 10);
+    Tokenizer tokenizer(exact);
+    vector <uint64_t> hashes;
+    for (const string& doc: docs) {
+        exact._count(doc, tokenizer, exact._counter, hashes);
+    }
+    assert(exact._counter.memory() > 1 << 21);
+
+    // check for both types of keys, sequentially and in parallel
+    for (bool intern_words: {false, true}) {
+        for (int n_jobs: {1, 4}) {
+
+            // phrases well above the minimum occurrence are kept
+            VHash vhash = VHash(2, 20, 10, 1E6, 100E3, 1000, 1, intern_words, n_jobs, 1 << 18).fit(docs, labels);
+            for (size_t index = 0; index < exact._counter.phrases.size(); index++) {
+                if (exact._counter.counts[index] < 60) {continue;}
+                string phrase = string(exact._counter.phrases.key(index));
+                assert(vhash._table.find(vhash._key(phrase)) != FrozenTable::npos);
+            }
+        }
+    }
+
+    // without a budget, scanning keeps more than the budget for every doc
+    vector <string_view> views = _views(docs);
+    Scan scan;
+    scan.scanned.assign(docs.size(), true);
+    VHash unbounded = VHash(2, 20, 10, 1E6, 100E3, 1000, 1, false, 1);
+    unbounded._create_table(views, scan);
+    assert(scan.memory() > 1 << 18);
+
+    // under a budget, nothing is kept per doc, and counting peaks within it
+    scan = Scan();
+    scan.scanned.assign(docs.size(), true);
+    VHash bounded = VHash(2, 20, 10, 1E6, 100E3, 1000, 1, false, 1, 1 << 18);
+    bounded._create_table(views, scan);
+    assert(scan.memory() == 0);
+    bounded._start_counting();
+    bounded._count_docs(views, scan.scanned, nullptr, nullptr);
+    assert(bounded._counter.peak > 0);
+    assert(bounded._counter.sketch.memory() + bounded._counter.peak + scan.memory() <= 1 << 18);
+
+    // and the fitted model transforms the same as if docs were tokenized again
+    vector <vector <float>> fitted = bounded.fit_transform(docs, labels), transformed = bounded.transform(docs);
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+        for (size_t g = 0; g < fitted[doc_num].size(); g++) {
+            assert(maths::isclose(fitted[doc_num][g], transformed[doc_num][g]));
+        }
+    }
+
+    // skew words by class, with classes in separate halves of the stream
+    // (so phrases evicted in one half miss that class entirely)
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+        labels[doc_num] = doc_num * 2 / docs.size();
+        docs[doc_num].clear();
+        for (size_t word_num = 0; word_num < 20; word_num++) {
+            size_t word = (rand() % 1000 * (rand() % 1000) / 1000 + labels[doc_num] * (rand() % 2) * 37) % 1000;
+            docs[doc_num] += string("w") + char('a' + word / 100) + char('a' + word / 10 % 10) + char('a' + word % 10) + " ";
+        }
+    }
+    VHash exact_counts = VHash(2, 20, 10);
+    exact_counts.partial_fit(docs, labels);
+    VHash exact_weights = exact_counts;
+    exact_weights.finalize();
+    const Counter& exact_counter = exact_counts._counter;
+
+    // phrases that weren't candidates for some of their docs (below the
+    // floor, or evicted) get the missing document frequencies from the
+    // sketch, so their weights stay close to exact ones
+    for (int n_jobs: {1, 4}) {
+        VHash vhash = VHash(2, 20, 10, 1E6, 100E3, 1000, 1, false, n_jobs, 1 << 18);
+        vhash.partial_fit(docs, labels);
+        vector <string> missed;
+        for (size_t index = 0; index < vhash._counter.phrases.size(); index++) {
+            string phrase = string(vhash._counter.phrases.key(index));
+            size_t exact_index = exact_counter.phrases.find(phrase);
+            if (exact_index == Table::npos) {continue;}
+            for (size_t class_num = 0; class_num < 2; class_num++) {
+                if (vhash._counter.doc_freq[2 * index + class_num] < exact_counter.doc_freq[2 * exact_index + class_num]) {
+                    missed.push_back(phrase);
+                    break;
+                }
+            }
+        }
+        vhash.finalize();
+        assert(!missed.empty());
+        float error = 0;
+        size_t num_found = 0;
+        for (const string& phrase: missed) {
+            size_t index = vhash._table.find(phrase);
+            size_t exact_index = exact_weights._table.find(phrase);
+            if (index == FrozenTable::npos || exact_index == FrozenTable::npos) {continue;}
+            error += std::abs(vhash._weights[index] - exact_weights._weights[exact_index]);
+            num_found++;
+        }
+        assert(num_found > 0);
+        assert(error / num_found < 0.1);
+    }
+}
+
+void VHash::_test_partial_fit() {
+
+    // make data
+    vector <string> docs = _get_many_test_docs(5000);
+    vector <size_t> labels(docs.size());
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+        labels[doc_num] = doc_num % 3;
+    }
+
+    // check for both types of keys, sequentially and in parallel
+    for (bool intern_words: {false, true}) {
+        for (int n_jobs: {1, 4}) {
+
+            // fit at once, and in (unevenly sized) batches
+            for (size_t live_evaluation_step: {100000, 700}) {
+                VHash vhash = VHash(3, 1E-3, 20, 150, 100E3, live_evaluation_step, 1, intern_words, n_jobs);
+                VHash fitted = vhash;
+                fitted.fit(docs, labels);
+                for (size_t start = 0, size = 1; start < docs.size(); start += size, size = size * 3 + 1) {
+                    size_t end = start + size < docs.size()? start + size: docs.size();
+                    vhash.partial_fit(
+                        vector <string>(docs.begin() + start, docs.begin() + end),
+                        vector <size_t>(labels.begin() + start, labels.begin() + end)
+                    );
+                }
+                vhash.finalize();
+
+                // tables contain the same phrases (even with live evaluations)
+                assert(vhash._table.size() == fitted._table.size());
+                assert(vhash._num_docs == fitted._num_docs);
+                for (size_t index = 0; index < fitted._table.size(); index++) {
+                    size_t found = vhash._table.find(vhash._key(fitted._phrase(index)));
+                    assert(found != FrozenTable::npos);
+
+                    // and the same weights (if counts are exact)
+                    if (live_evaluation_step > docs.size()) {
+                        assert(maths::isclose(vhash._weights[found], fitted._weights[index]));
+                    }
+                }
+
+                // features are made, and fitting structures are freed
+                assert(vhash._features_size == 20);
+                assert(vhash.transform(docs).size() == docs.size());
+                assert(vhash._counter.phrases.empty());
+                assert(vhash._samples.empty());
+            }
+        }
+    }
+
+    // mismatched labels throw, without counting the batch
+    VHash vhash = VHash(3, 1E-3, 20);
+    for (const vector <size_t>& labels: {vector <size_t>(), vector <size_t>(docs.size() - 1)}) {
+        bool thrown = false;
+        try {
+            vhash.partial_fit(docs, labels);
+        } catch (const std::invalid_argument&) {
+            thrown = true;
+        }
+        assert(thrown);
+        assert(vhash._counter.num_docs == 0);
+    }
+}
+
+void VHash::_test_files() {
+
+    // write docs and labels
+    auto [docs, labels] = _get_test_data();
+    ofstream docs_file = files::open <ofstream>("bin/test.bin");
+    ofstream labels_file = files::open <ofstream>("bin/test_labels.bin");
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+        docs_file << docs[doc_num] << (doc_num % 2? "\r\n": "\n");
+        labels_file << (labels[doc_num]? "yes": "no") << '\n';
+    }
+    docs_file.close();
+    labels_file.close();
+
+    // fitting from files matches fitting from memory
+    VHash from_file = VHash(3, 1, 4, 1E6, 100E3, 10E3);
+    VHash in_memory = from_file;
+    from_file.fit_file("bin/test.bin", "bin/test_labels.bin");
+    in_memory.fit(docs, labels);
+    assert(from_file._table.size() == in_memory._table.size());
+    for (size_t index = 0; index < in_memory._table.size(); index++) {
+        size_t found = from_file._table.find(from_file._key(in_memory._phrase(index)));
+        assert(found != FrozenTable::npos);
+        assert(maths::isclose(from_file._weights[found], in_memory._weights[index]));
+    }
+
+    // transformed file holds a .npy header, then the transformed docs
+    from_file.transform_file("bin/test.bin", "bin/test_out.bin");
+    vector <vector <float>> expected = from_file.transform(docs);
+    files::MappedFile out("bin/test_out.bin");
+    string header = files::npy_header(docs.size(), from_file._features_size);
+    assert(out.view().substr(0, header.size()) == header);
+    assert(out.size() == header.size() + docs.size() * from_file._features_size * sizeof(float));
+    const float* values = (const float*)(out.data() + header.size());
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+        for (size_t feature = 0; feature < from_file._features_size; feature++) {
+            assert(values[doc_num * from_file._features_size + feature] == expected[doc_num][feature]);
+        }
+    }
+
+    // unlabeled docs match fitting docs all in one class
+    VHash unlabeled = VHash(3, 1, 4, 1E6, 100E3, 10E3);
+    VHash one_class = unlabeled;
+    unlabeled.fit_file("bin/test.bin", "");
+    one_class.fit(docs, vector <size_t>(docs.size(), 0));
+    assert(unlabeled._table.size() == one_class._table.size());
+    assert(unlabeled.transform(docs) == one_class.transform(docs));
+
+    // mismatched labels throw
+    labels_file = files::open <ofstream>("bin/test_labels.bin");
+    labels_file << "yes\n";
+    labels_file.close();
+    bool thrown = false;
+    try {
+        from_file.fit_file("bin/test.bin", "bin/test_labels.bin");
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+void VHash::_test_save_load() {
+    vector <string> docs = _get_many_test_docs(1000);
+    vector <size_t> labels(docs.size());
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+        labels[doc_num] = doc_num % 3;
+    }
+
+    // check for both types of keys
+    for (bool intern_words: {false, true}) {
+
+        // save, and load in place
+        VHash vhash = VHash(3, 1E-3, 20, 1E6, 100E3, 10E3, 1, intern_words, 2).fit(docs, labels);
+        vhash.save("bin/test.bin");
+        VHash loaded = VHash::load("bin/test.bin");
+
+        // model is the same
+        assert(loaded._intern_words == intern_words);
+        assert(loaded._n_jobs == 2);
+        assert(loaded._table.size() == vhash._table.size());
+        assert(loaded._words.size() == vhash._words.size());
+        for (size_t index = 0; index < vhash._table.size(); index++) {
+            assert(loaded._table.find(vhash._table.key(index)) == index);
+        }
+        assert(loaded.transform(docs) == vhash.transform(docs));
+
+        // saving over the loaded model's file leaves it usable
+        VHash(2).fit(docs, labels).save("bin/test.bin");
+        assert(loaded.transform(docs) == vhash.transform(docs));
+    }
+
+    // unfitted models round-trip too
+    VHash().save("bin/test.bin");
+    assert(VHash::load("bin/test.bin").num_features() == 0);
+
+    // models round-trip through bytes in memory (as when pickled)
+    VHash vhash = VHash(3, 1E-3, 20).fit(docs, labels);
+    std::ostringstream stream;
+    vhash._write(stream);
+    files::MappedReader reader = files::MappedReader::from_bytes(stream.str());
+    assert(_read(reader, "bytes").transform(docs) == vhash.transform(docs));
+
+    // other files (including other versions of the format) throw
+    string other_version = stream.str();
+    other_version[sizeof(_file_magic)]++;
+    vector <string> bad_contents = {
+        "",
+        "not a model",
+        string(_file_magic, 8) + string("\0\0\0\0", 4),
+        string(_file_magic, 8) + string("\x09\0\0\0", 4),
+        other_version
+    };
+    for (const string& contents: bad_contents) {
+        ofstream file = files::open <ofstream>("bin/test.bin");
+        file << contents;
+        file.close();
+        bool thrown = false;
+        try {
+            VHash::load("bin/test.bin");
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+}
+
+void VHash::_test_stats() {
+    vector <string> docs = _get_many_test_docs(2000);
+    vector <size_t> labels(docs.size());
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+        labels[doc_num] = doc_num % 3;
+    }
+
+    // collect stats (in parallel, with live evaluations)
+    VHash vhash = VHash(3, 1E-3, 20, 300, 100E3, 500, 1, false, 4).fit(docs, labels);
+    vhash.reset_stats();
+    vhash.fit_transform(docs, labels);
+    vhash.transform(docs);
+    const Stats& stats = vhash.stats();
+    size_t num_transformed = 0;
+    for (const uint64_t& count: stats.latency_histogram()) {
+        num_transformed += count;
+    }
+
+    // without instrumentation, stats stay zero
+    if (!Stats::enabled) {
+        assert(stats.count(Stats::Counter::docs_fit) == 0);
+        assert(stats.seconds(Stats::Stage::tokenize) == 0);
+        assert(num_transformed == 0);
+        return;
+    }
+
+    // every doc is counted, and transformed once while fitting and once after
+    assert(stats.count(Stats::Counter::docs_fit) == docs.size());
+    assert(stats.count(Stats::Counter::docs_transformed) == 2 * docs.size());
+    assert(num_transformed == 2 * docs.size());
+    assert(stats.count(Stats::Counter::phrases_found) > 0);
+    assert(stats.count(Stats::Counter::phrases_oov) > 0);
+    assert(
+        stats.count(Stats::Counter::phrases_generated) >=
+        stats.count(Stats::Counter::phrases_found) + stats.count(Stats::Counter::phrases_oov)
+    );
+    assert(stats.count(Stats::Counter::prunes) > 1);
+    assert(stats.count(Stats::Counter::phrases_pruned) > 0);
+    for (size_t stage = 0; stage < (size_t)Stats::Stage::size; stage++) {
+        assert(stats.seconds((Stats::Stage)stage) > 0);
+    }
+
+    // reset
+    vhash.reset_stats();
+    assert(vhash.stats().count(Stats::Counter::docs_fit) == 0);
+    assert(vhash.stats().latency_histogram()[0] == 0);
+}
+
+void VHash::_test_memory_usage() {
+    vector <string> docs = _get_many_test_docs(1000);
+    vector <size_t> labels(docs.size(), 0);
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num += 2) {
+        labels[doc_num] = 1;
+    }
+
+    // unfitted models use no memory
+    assert(VHash().memory_usage()["total"] == 0);
+
+    // check for both types of keys
+    for (bool intern_words: {false, true}) {
+        VHash vhash = VHash(3, 1E-3, 20, 1E6, 100E3, 10E3, 1, intern_words).fit(docs, labels);
+        std::map <string, size_t> usage = vhash.memory_usage();
+
+        // components are at least as big as their contents
+        assert(usage["weights"] >= vhash._table.size() * sizeof(float));
+        assert(usage["feature_values"] >= vhash._postings_value.size() * sizeof(float));
+        assert(usage["feature_indices"] >= (vhash._table.size() + 1) * sizeof(uint64_t));
+        assert(usage["vocabulary_keys"] > 0);
+        assert(usage["vocabulary_index"] > 0);
+        assert((usage["word_keys"] > 0) == intern_words);
+        assert(usage["fitting"] == 0);
+
+        // total adds up
+        size_t total = 0;
+        for (const auto& [component, bytes]: usage) {
+            if (component != "total") {total += bytes;}
+        }
+        assert(usage["total"] == total);
+
+        // loaded models use the same memory (as views of the file)
+        vhash.save("bin/test.bin");
+        std::map <string, size_t> loaded = VHash::load("bin/test.bin").memory_usage();
+        assert(loaded["weights"] == vhash._table.size() * sizeof(float));
+        assert(loaded["total"] <= usage["total"]);
+    }
+
+    // partial fits count their fitting structures
+    VHash partial = VHash(3, 1E-3, 20);
+    partial.partial_fit(docs, labels);
+    assert(partial.memory_usage()["fitting"] > 0);
+    partial.finalize();
+    assert(partial.memory_usage()["fitting"] == 0);
+}
+
+void VHash::_test_quantize() {
+    vector <string> docs = _get_many_test_docs(1000);
+    vector <size_t> labels(docs.size());
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+        labels[doc_num] = doc_num % 3;
+    }
+    VHash vhash = VHash(3, 1E-3, 20).fit(docs, labels);
+    vector <vector <float>> expected = vhash.transform(docs);
+
+    // unknown quantization throws
+    bool thrown = false;
+    try {
+        VHash(3, 1E-3, 20, 1E6, 100E3, 10E3, 1, false, 1, 0, "int4");
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    // check each quantization (of the same fitted model)
+    for (const Quantize& quantize: {Quantize::fp16, Quantize::int8}) {
+        float tolerance = quantize == Quantize::fp16? 1E-2: 5E-2;
+        VHash quantized = vhash;
+        quantized._quantize = quantize;
+        quantized._quantize_features();
+        assert(quantized._postings_value.empty() && quantized._weights.empty());
+
+        // transforms are close to the unquantized model's
+        vector <vector <float>> transformed = quantized.transform(docs);
+        for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+            for (size_t feature_num = 0; feature_num < vhash._features_size; feature_num++) {
+                assert(fabs(transformed[doc_num][feature_num] - expected[doc_num][feature_num]) < tolerance);
+            }
+        }
+
+        // half precision and int8 outputs match float outputs
+        size_t num_values = docs.size() * vhash._features_size;
+        vector <uint16_t> half(num_values);
+        vector <int8_t> int8(num_values);
+        quantized.transform(docs, half.data(), vhash._features_size);
+        quantized.transform(docs, int8.data(), vhash._features_size);
+        for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+            for (size_t feature_num = 0; feature_num < vhash._features_size; feature_num++) {
+                float value = transformed[doc_num][feature_num];
+                size_t i = doc_num * vhash._features_size + feature_num;
+                assert(half[i] == quant::to_half(value));
+                assert(int8[i] == quant::to_int8(value, 1 / 127.f));
+            }
+        }
+
+        // feature values take less memory
+        std::map <string, size_t> usage = quantized.memory_usage();
+        assert(usage["feature_values"] < vhash.memory_usage()["feature_values"]);
+        assert(usage["weights"] < vhash.memory_usage()["weights"]);
+
+        // quantized models round-trip
+        quantized.save("bin/test.bin");
+        VHash loaded = VHash::load("bin/test.bin");
+        assert(loaded._quantize == quantize);
+        assert(loaded.transform(docs) == transformed);
+    }
+
+    // quantization is applied when fitting
+    VHash fitted = VHash(3, 1E-3, 20, 1E6, 100E3, 10E3, 1, false, 1, 0, "int8").fit(docs, labels);
+    assert(fitted._postings_value.empty() && !fitted._postings_int8.empty());
+    assert(fitted._feature_scales.size() == fitted._features_size);
+}
+
+void VHash::_test_feature_capping() {
+    vector <string> docs = _get_many_test_docs(1000);
+    vector <size_t> labels(docs.size());
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+        labels[doc_num] = doc_num % 3;
+    }
+    VHash vhash = VHash(3, 1E-3, 20).fit(docs, labels);
+    vector <vector <float>> expected = vhash.transform(docs);
+
+    // uncapped features have no error
+    for (const float& error: vhash.feature_errors()) {
+        assert(error == 0);
+    }
+
+    // bad masses throw
+    for (float feature_mass: {0.f, 1.5f}) {
+        bool thrown = false;
+        try {
+            VHash(3, 1E-3, 20, 1E6, 100E3, 10E3, 1, false, 1, 0, "none", 0, feature_mass);
+        } catch (const std::invalid_argument&) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+
+    // cap each feature (of the same fitted model), by number of terms and by mass
+    for (size_t max_terms: {(size_t)0, (size_t)5}) {
+        for (float mass: {1.f, 0.9f}) {
+            VHash capped = vhash;
+            capped._max_feature_terms = max_terms;
+            capped._feature_mass = mass;
+
+            // rebuild features from postings
+            size_t total_terms = 0;
+            vector <Sparse> features(vhash._features_size);
+            for (Sparse& feature: features) {feature.max_index = vhash._table.size();}
+            for (size_t index = 0; index < vhash._table.size(); index++) {
+                for (uint64_t p = vhash._postings_start[index]; p < vhash._postings_start[index + 1]; p++) {
+                    features[vhash._postings_feature[p]].indices.push_back(index);
+                    features[vhash._postings_feature[p]].values.push_back(vhash._postings_value[p]);
+                }
+            }
+
+            // capped features have bounded terms, unit norm, and the reported error
+            for (const Sparse& full: features) {
+                Sparse feature = full;
+                float error = capped._cap_feature(feature);
+                total_terms += feature.num_nonzero();
+                assert(!max_terms || feature.num_nonzero() <= max_terms);
+                assert(std::is_sorted(feature.indices.begin(), feature.indices.end()));
+                assert(fabs(maths::norm(feature.values) - maths::norm(full.values)) < 1E-4);
+                float moved = 0;
+                for (size_t g = 0; g < full.num_nonzero(); g++) {
+                    auto found = std::find(feature.indices.begin(), feature.indices.end(), full.indices[g]);
+                    float value = found == feature.indices.end()? 0: feature.values[found - feature.indices.begin()];
+                    moved += (value - full.values[g]) * (value - full.values[g]);
+                }
+                assert(fabs(sqrt(moved) - error) < 1E-4);
+                if (feature.num_nonzero() == full.num_nonzero()) {assert(error == 0);}
+                if (mass < 1 && !max_terms) {assert(error < sqrt(2 - 2 * sqrt(mass)) + 1E-4);}
+            }
+            if (max_terms || mass < 1) {assert(total_terms < vhash._postings_feature.size());}
+        }
+    }
+
+    // fitting caps features, and records their errors
+    VHash capped = VHash(3, 1E-3, 20, 1E6, 100E3, 10E3, 1, false, 1, 0, "none", 3).fit(docs, labels);
+    assert(capped._postings_feature.size() <= 3 * capped._features_size);
+    vector <float> errors = capped.feature_errors();
+    assert(errors.size() == capped._features_size);
+    assert(*std::max_element(errors.begin(), errors.end()) > 0);
+    capped.save("bin/test.bin");
+    VHash loaded = VHash::load("bin/test.bin");
+    assert(loaded.feature_errors() == errors);
+    assert(loaded._max_feature_terms == 3);
+    assert(loaded.transform(docs) == capped.transform(docs));
+}
+
+void VHash::_test_transform_sparse() {
+
+    // fit model
+    vector <string> docs = _get_many_test_docs(1000);
+    vector <size_t> labels(docs.size());
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+        labels[doc_num] = doc_num % 3;
+    }
+    for (const char* quantize: {"none", "fp16"}) {
+        for (int n_jobs: {1, 3}) {
+            VHash vhash = VHash(3, 1E-3, 20, 1E6, 100E3, 10E3, 1, false, n_jobs, 0, quantize).fit(docs, labels);
+            vector <string> queries = docs;
+            queries.push_back("");
+            queries.push_back("unseen phrases");
+            vector <float> data;
+            vector <int32_t> indices;
+            vector <int64_t> indptr;
+            vhash.transform_sparse(queries, data, indices, indptr);
+            assert(indptr.size() == queries.size() + 1);
+            assert(indptr.front() == 0);
+            assert((size_t)indptr.back() == data.size());
+            assert(indices.size() == data.size());
+
+            // rows match weighted docs, and project onto transformed docs
+            vector <vector <float>> transformed = vhash.transform(queries);
+            Tokenizer tokenizer(vhash);
+            for (size_t doc_num = 0; doc_num < queries.size(); doc_num++) {
+                vhash._find_indices(queries[doc_num], tokenizer);
+                Sparse expected = vhash._weigh(tokenizer.indices);
+                Sparse row;
+                row.max_index = vhash.num_phrases();
+                row.indices.assign(indices.begin() + indptr[doc_num], indices.begin() + indptr[doc_num + 1]);
+                row.values.assign(data.begin() + indptr[doc_num], data.begin() + indptr[doc_num + 1]);
+                assert(row.indices == expected.indices);
+                assert(row.values == expected.values);
+                vector <float> projected(vhash.num_features());
+                vhash._scatter(row, projected.data(), nullptr);
+                assert(projected == transformed[doc_num]);
+            }
+
+            // docs without known phrases have empty rows
+            assert(indptr[queries.size() - 2] == indptr[queries.size()]);
+
+            // weighing matches weighting and normalizing vectorized docs
+            if (vhash._quantize == Quantize::none) {
+                vhash._find_indices(docs[0], tokenizer);
+                Sparse vectorized = vhash._vectorize(tokenizer.indices);
+                Sparse expected = vectorized.multiply(vhash._weights, true).normalize();
+                assert(vhash._weigh(tokenizer.indices).values == expected.values);
+            }
+        }
+    }
+}
+
+void VHash::_test_concurrency() {
+
+    // fit model
+    vector <string> docs = _get_many_test_docs(2000);
+    vector <size_t> labels(docs.size());
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+        labels[doc_num] = doc_num % 3;
+    }
+    srand(0);
+    VHash vhash = VHash(3, 1E-3, 20).fit(docs, labels);
+    vector <vector <float>> expected = vhash.transform(docs);
+
+    // refit (to the same model) on one thread, while transforming on another
+    std::atomic <bool> fitting = true;
+    std::thread fitter([&]() {
+        for (size_t round = 0; round < 5; round++) {
+            srand(0);
+            vhash.fit(docs, labels);
+        }
+        fitting = false;
+    });
+    size_t num_transforms = 0;
+    do {
+        vector <vector <float>> vecs = vhash.transform(docs);
+        for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+            for (size_t feature_num = 0; feature_num < expected[doc_num].size(); feature_num++) {
+                assert(maths::isclose(vecs[doc_num][feature_num], expected[doc_num][feature_num]));
+            }
+        }
+        num_transforms++;
+    } while (fitting);
+    fitter.join();
+    assert(num_transforms > 1);
+
+    // copies get their own lock
+    VHash copy = vhash;
+    std::unique_lock <std::shared_mutex> guard(vhash._lock.mutex);
+    assert(copy.transform(docs) == expected);
+}
@@ -1,17 +1,31 @@
 #ifndef VHASH_VHASH_H
 #define VHASH_VHASH_H
 
-#include <unordered_map>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include <utils/buffer.h>
+#include <utils/files.h>
+#include <utils/frozen.h>
+#include <utils/quant.h>
+#include <utils/sketch.h>
 #include <utils/sparse.h>
+#include <utils/table.h>
+#include <utils/text.h>
+#include <vhash/stats.h>
 
-using std::unordered_map;
+using std::ostream;
 using std::string;
+using std::string_view;
 using std::vector;
 
 #ifndef __CXX_TESTING__
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 namespace py = pybind11;
@@ -20,10 +34,20 @@ namespace py = pybind11;
 
 namespace vhash {
 
+    // benchmarks (in cxx/bench)
+    class Bench;
+
+    // pipelined transforms (in vhash/pipeline.h)
+    class VHashPipeline;
+
     /* Hash table for vector quantization of text documents
 
     Check out the documentation for a full description of this class's
     operations.
+
+    Methods are thread-safe: transforms share a lock, while fitting takes it
+    exclusively (so Python can release the GIL while they run). Copying a
+    model that another thread is fitting isn't.
     */
     class VHash {
         public:
@@ -39,7 +63,13 @@ namespace vhash {
                 const size_t& max_num_phrases = 1E6,
                 const size_t& downsample_to = 100E3,
                 const size_t& live_evaluation_step = 10E3,
-                const size_t& smallest_ngram = 1
+                const size_t& smallest_ngram = 1,
+                const bool&   intern_words = false,
+                const int&    n_jobs = 1,
+                const size_t& memory_budget = 0,
+                const string& quantize = "none",
+                const size_t& max_feature_terms = 0,
+                const float&  feature_mass = 1
             );
 
             /* virtual destructor
@@ -57,6 +87,28 @@ namespace vhash {
                 const vector <size_t>& labels
             );
 
+            /* Count phrases in a batch of docs, to fit a model incrementally
+
+            Call finalize() after the last batch.
+
+            Check out docs or vhash/vhash.py for full docstring
+
+            Raises
+            ------
+            std::invalid_argument
+                if there isn't one label for each doc
+             */
+            void partial_fit(
+                const vector <string>& docs,
+                const vector <size_t>& labels
+            );
+
+            /* Finish fitting a model from batches passed to partial_fit()
+
+            Check out docs or vhash/vhash.py for full docstring
+             */
+            void finalize();
+
             /* Fit model, transform docs
 
             Check out docs or vhash/vhash.py for full docstring
@@ -74,17 +126,288 @@ namespace vhash {
                 const vector <string>& docs
             );
 
+            /* Transform docs into a caller-provided buffer
+
+            Parameters
+            ----------
+            docs: const vector <string>&
+                documents to transform
+            out: float*
+                row-major output: row `x` (for `docs[x]`) starts at
+                `out + x * row_stride`, and has `num_features()` values
+            row_stride: const size_t&
+                distance between the starts of consecutive rows (in floats)
+             */
+            void transform(
+                const vector <string>& docs,
+                float* out,
+                const size_t& row_stride
+            );
+
+            /* Transform docs into a caller-provided buffer, in half precision
+
+            Identical to transform() into a float buffer, but writes the bits
+            of IEEE 754 half-precision values (i.e. numpy float16).
+             */
+            void transform(
+                const vector <string>& docs,
+                uint16_t* out,
+                const size_t& row_stride
+            );
+
+            /* Transform docs into a caller-provided buffer, as int8
+
+            Identical to transform() into a float buffer, but writes each
+            value (which is in [0, 1]) multiplied by 127, and rounded.
+             */
+            void transform(
+                const vector <string>& docs,
+                int8_t* out,
+                const size_t& row_stride
+            );
+
+            /* Weighted, normalized phrase vector of each doc, in CSR format
+
+            These are the vectors that transform() projects onto the
+            features: the log count of each phrase in the vocabulary, times
+            its weight, normalized to unit length. Phrases are columns (see
+            num_phrases()), in sorted order within each row. Rows are written
+            straight into the outputs, without projecting them.
+
+            Parameters
+            ----------
+            docs: const vector <string>&
+                documents to transform
+            data: vector <float>&
+                output: nonzero values of all rows, concatenated
+            indices: vector <int32_t>&
+                output: column (phrase number) of each value
+            indptr: vector <int64_t>&
+                output: row `x` (for `docs[x]`) is
+                `[indptr[x], indptr[x+1])` of data and indices (so this has
+                `docs.size() + 1` values)
+             */
+            void transform_sparse(
+                const vector <string>& docs,
+                vector <float>& data,
+                vector <int32_t>& indices,
+                vector <int64_t>& indptr
+            );
+
+            /* Train model on a file of documents, one per line
+
+            The file is memory-mapped, and documents are tokenized straight
+            from the mapped pages, without copying them into strings.
+
+            Check out docs or vhash/vhash.py for full docstring
+
+            Parameters
+            ----------
+            path: const string&
+                file of documents (newline-delimited)
+            labels_path: const string&
+                file with the class label of each document on the
+                corresponding line (labels are arbitrary strings), or ""
+                for no labels (all documents in one class)
+
+            Raises
+            ------
+            std::runtime_error
+                if a file can't be read
+            std::invalid_argument
+                if the files have different numbers of lines
+             */
+            VHash fit_file(
+                const string& path,
+                const string& labels_path
+            );
+
+            /* Transform a file of documents, one per line, into a .npy file
+
+            Rows are written straight into the memory-mapped output file,
+            which holds a float32 array of shape `(num_docs, num_features())`.
+
+            Parameters
+            ----------
+            path: const string&
+                file of documents (newline-delimited)
+            out_path: const string&
+                .npy file to create (or overwrite)
+
+            Raises
+            ------
+            std::runtime_error
+                if a file can't be read or created
+             */
+            void transform_file(
+                const string& path,
+                const string& out_path
+            );
+
+            /* Save fitted model to a binary file
+
+            The file is versioned, and laid out so that load() can use the
+            vocabulary, weights and features straight from the mapped file.
+
+            Parameters
+            ----------
+            path: const string&
+                file to create (or replace)
+
+            Raises
+            ------
+            std::runtime_error
+                if the file can't be written
+             */
+            void save(const string& path) const;
+
+            /* Load model saved by save()
+
+            The file is memory-mapped, and the model's arrays view it in
+            place, without parsing or copying (so it loads in constant time,
+            and pages are shared between processes loading the same file).
+            The file must not be modified while the model is in use (save()
+            replaces files, rather than overwriting them, so saving over a
+            loaded model is safe).
+
+            Parameters
+            ----------
+            path: const string&
+                file to load
+
+            Returns
+            -------
+            VHash
+                fitted model
+
+            Raises
+            ------
+            std::runtime_error
+                if the file can't be read, isn't a model file, has an
+                unsupported version, or is malformed
+             */
+            static VHash load(const string& path);
+
+            /* Number of features (dimension of each transformed doc)
+
+            Returns
+            -------
+            size_t
+                number of features, as fitted
+             */
+            size_t num_features() const {return _features_size;}
+
+            /* Number of phrases in the vocabulary (number of columns of
+            transform_sparse())
+
+            Returns
+            -------
+            size_t
+                number of phrases, as fitted
+             */
+            size_t num_phrases() const {return _table.size();}
+
+            /* Approximation error of each feature, from capping its terms
+
+            Features keep at most `max_feature_terms` terms, and only as many
+            as needed to hold `feature_mass` of their squared L2 norm (set in
+            constructor). The error is the L2 distance between the capped
+            (renormalized) feature and the full feature, which bounds how far
+            any transformed value can move.
+
+            Returns
+            -------
+            vector <float>
+                error of each feature (0 if uncapped)
+             */
+            vector <float> feature_errors() const {
+                std::shared_lock <std::shared_mutex> guard(_lock.mutex);
+                return vector <float>(_feature_errors.begin(), _feature_errors.end());
+            }
+
+            /* Memory used by each component of the model
+
+            Sizes come from actual capacities. For a loaded model, arrays view
+            the mapped file, so their memory is file-backed pages (shared
+            between processes loading the same file), rather than heap.
+
+            Returns
+            -------
+            std::map <string, size_t>
+                bytes used by:
+
+                * vocabulary_keys: phrases in the table
+                * vocabulary_index: the table's perfect hash function
+                * word_keys: words (if interning words)
+                * word_index: the word table's perfect hash function
+                * weights: phrase weights
+                * feature_indices: postings offsets and feature numbers
+                * feature_values: postings values
+                * fitting: counts kept between partial_fit() calls
+                * total: sum of the above
+             */
+            std::map <string, size_t> memory_usage() const;
+
+            /* Stats collected while fitting and transforming
+
+            Stats are only collected if compiled with VHASH_STATS defined
+            (see vhash/stats.h). Otherwise, they are always zero.
+
+            Returns
+            -------
+            const Stats&
+                time spent in each stage, counts, and per-document latencies
+             */
+            const Stats& stats() const {return _stats;}
+
+            /* Reset stats to zero */
+            void reset_stats() {_stats.reset();}
+
+            // numpy support
+            #ifndef __CXX_TESTING__
+            py::array fit_transform_numpy(
+                const vector <string>& docs,
+                const vector <size_t>& labels
+            );
+            py::array transform_numpy(
+                const vector <string>& docs,
+                const py::object& out,
+                const string& dtype
+            );
+            py::tuple transform_sparse_numpy(const vector <string>& docs);
+            py::dict stats_dict() const;
+            #endif
+
             // pickle support
             #ifndef __CXX_TESTING__
-            static py::tuple __get_state__(const vhash::VHash&);
-            static VHash __set_state__(py::tuple);
+            static py::bytes __get_state__(const vhash::VHash&);
+            static VHash __set_state__(const py::bytes&);
             #endif
 
             /* public access to testing private methods */
             static void _test();
 
+            /* access to private methods, for benchmarks */
+            friend class Bench;
+
+            /* access to private stages of transform(), for pipelining */
+            friend class VHashPipeline;
+
         private:
 
+            // ===============================================================
+            // thread safety
+
+            // shared by transforms, and held exclusively while fitting (copies
+            // get a new mutex, so models stay copyable)
+            struct Lock {
+                mutable std::shared_mutex mutex;
+                Lock() = default;
+                Lock(const Lock&) {}
+                Lock& operator=(const Lock&) {return *this;}
+            };
+            Lock _lock;
+
             // ===============================================================
             // construction parameters
 
@@ -95,65 +418,426 @@ namespace vhash {
             size_t _downsample_to;
             size_t _live_evaluation_step;
             size_t _smallest_ngram;
+            bool   _intern_words;
+            int    _n_jobs;
+            size_t _memory_budget;
+
+            // how feature values and weights are stored
+            enum class Quantize: uint8_t {
+                none,   // float
+                fp16,   // half precision
+                int8,   // int8 feature values (with a scale for each feature),
+                        // and half-precision weights
+            };
+            Quantize _quantize = Quantize::none;
+
+            // most terms to keep in each feature (0 for all), and fraction of
+            // each feature's squared L2 norm to keep
+            size_t _max_feature_terms = 0;
+            float  _feature_mass = 1;
+
+            // ===============================================================
+            // model file format (see save())
+
+            // first bytes of a model file
+            static constexpr char _file_magic[8] = {'V', 'H', 'A', 'S', 'H', 'M', 'D', 'L'};
+
+            // version of model file format (files of any other version are
+            // rejected, so bump it on any layout change)
+            static constexpr uint32_t _file_version = 1;
+
+            // written in native byte order, to detect files from other platforms
+            static constexpr uint32_t _file_byte_order = 0x01020304;
+
+            // write model, laid out as in a model file
+            void _write(ostream& file) const;
+
+            // read model written by _write() (`name` identifies the source in errors)
+            static VHash _read(utils::files::MappedReader& reader, const string& name);
 
             // ===============================================================
             // fitting helper variables
 
             // number of documents used for fitting
-            size_t _num_docs;
+            size_t _num_docs = 0;
+
+            // phrase counts, for building a table
+            struct Counter {
+
+                // phrases (phrase index = entry number)
+                utils::Table phrases;
+
+                // words (word id = entry number), if interning words
+                utils::Table words;
+
+                // count of each phrase
+                vector <size_t> counts;
+
+                // number of classes (0 if not counting document frequencies)
+                size_t num_classes = 0;
+
+                // number of documents in each class
+                vector <size_t> docs_in_class;
+
+                // number of documents in each class containing each phrase
+                // (doc_freq[index * num_classes + class_num])
+                vector <size_t> doc_freq;
+
+                // number of documents passed through (i.e. position in the
+                // stream of documents, for live evaluations)
+                size_t num_docs = 0;
+
+                // approximate counts of all phrases (only used with a memory
+                // budget). If used, `phrases` only holds candidates for the
+                // vocabulary, and `counts` holds their estimated counts
+                utils::CountMin sketch;
+
+                // approximate document frequencies in each class of phrases
+                // while they aren't candidates (only used with a memory
+                // budget, when counting them), keyed by `class_hash`. If
+                // used, it's added to `doc_freq` once counting finishes, so
+                // evicted or late-admitted phrases keep their frequencies
+                utils::CountMin doc_freq_sketch;
+
+                // smallest estimated count for a phrase to become a candidate
+                size_t floor = 0;
+
+                // memory budget for phrases, words and counts (if using sketch)
+                size_t budget = 0;
+
+                // most memory used by phrases, words and counts after
+                // fitting the budget (in bytes)
+                size_t peak = 0;
+
+                // count phrase, returning its index (or npos, if it isn't
+                // a candidate)
+                size_t add(const string_view& key, const uint64_t& hash, const size_t& count);
+
+                // start counting document frequencies for more classes
+                void set_num_classes(const size_t& num_classes_);
+
+                // key of a phrase's document frequency in a class, in
+                // `doc_freq_sketch`
+                static uint64_t class_hash(const uint64_t& hash, const size_t& class_num) {
+                    return hash ^ (class_num + 1) * 0x9E3779B97F4A7C15;
+                }
+
+                // smallest count (> 1) that keeps at most `max_size` phrases
+                size_t threshold(const size_t& max_size) const;
+
+                // remove phrases counted fewer than `thresh` times
+                void remove_infreq(const size_t& thresh);
+
+                // remove the least frequent half of candidates
+                void shrink();
+
+                // shrink, if over budget
+                void fit_budget() {
+                    if (!sketch.empty() && memory() > budget) {shrink();}
+                    if (memory() > peak) {peak = memory();}
+                }
+
+                // memory used by phrases, words and counts (in bytes)
+                size_t memory() const {
+                    return phrases.memory() + words.memory() + (counts.size() + doc_freq.size()) * sizeof(size_t);
+                }
+
+                // remove all entries (keeping the number of classes)
+                void clear() {
+                    phrases.clear();
+                    words.clear();
+                    counts.clear();
+                    docs_in_class.assign(num_classes, 0);
+                    doc_freq.clear();
+                    floor = 0;
+                }
+            };
+
+            // table being built
+            Counter _counter;
+
+            // documents sampled (while partially fitting) to make features
+            vector <string> _samples;
+
+            // documents scanned when fitting (so each is only tokenized once)
+            struct Scan {
+
+                // whether each document was scanned (i.e. used for fitting)
+                vector <char> scanned;
+
+                // hash of each table key in each scanned document (or, if
+                // interning words, of each word), recorded while counting
+                vector <vector <uint64_t>> hashes;
+
+                // sorted table index of each phrase in each scanned document
+                // (with repeats), resolved from hashes once the table is built
+                // (neither is kept under a memory budget, so docs are
+                // tokenized again instead)
+                vector <vector <uint32_t>> indices;
+
+                // whether a document's indices were kept
+                bool kept(const size_t& doc_num) const {
+                    return !indices.empty() && scanned[doc_num];
+                }
+
+                // memory used by hashes and indices (in bytes)
+                size_t memory() const {
+                    size_t bytes = 0;
+                    for (const vector <uint64_t>& doc: hashes) {bytes += doc.capacity() * sizeof(uint64_t);}
+                    for (const vector <uint32_t>& doc: indices) {bytes += doc.capacity() * sizeof(uint32_t);}
+                    return bytes;
+                }
+            };
 
             // ===============================================================
             // data members
 
-            // actual hash table
-            unordered_map <string, size_t> _table;
+            // actual hash table, frozen at the end of fitting
+            //
+            // keys are phrases, or (if interning words) the packed 32-bit ids
+            // of each word in the phrase. Each phrase's index is its entry
+            // number in the table.
+            utils::FrozenTable _table;
+
+            // words (only used if interning words). Each word's id is its
+            // entry number in the table.
+            utils::FrozenTable _words;
 
             // features for comparison when making dense reps
-            vector <utils::Sparse> _features;
+            size_t _features_size = 0;
+
+            // features, stored as an inverted index: the features containing
+            // the phrase with index `i` (in increasing order), and the
+            // feature's value for that phrase, are at positions
+            // `[_postings_start[i], _postings_start[i + 1])` of
+            // _postings_feature and _postings_value
+            utils::Buffer <uint64_t> _postings_start;
+            utils::Buffer <uint32_t> _postings_feature;
+            utils::Buffer <float> _postings_value;
+
+            // error of each feature from capping its terms (see feature_errors())
+            utils::Buffer <float> _feature_errors;
 
             // weight of each term, for vectorizing
-            vector <float> _weights;
+            utils::Buffer <float> _weights;
+
+            // quantized postings values and weights (replacing _postings_value
+            // and _weights, if quantizing): the bits of half-precision values,
+            // or int8 values that are multiplied by the scale of their feature
+            utils::Buffer <uint16_t> _postings_half;
+            utils::Buffer <int8_t> _postings_int8;
+            utils::Buffer <float> _feature_scales;
+            utils::Buffer <uint16_t> _weights_half;
+
+            // instrumentation (updated from const methods, and from threads)
+            mutable Stats _stats;
 
             // ===============================================================
             // fitting functions
 
+            // train model, keeping scanned documents
+            void _fit(
+                const vector <string_view>& docs,
+                const vector <size_t>& labels,
+                Scan& scan
+            );
+
             // insert terms into hash table
             void _create_table(
-                const vector <string>& docs,
-                const vector <char>& insert_me
+                const vector <string_view>& docs,
+                Scan& scan
+            );
+
+            // start counting phrases into _counter (sketching document
+            // frequencies too, if `doc_freqs` and under a memory budget)
+            void _start_counting(const bool& doc_freqs = false);
+
+            // count phrases of selected docs into _counter, one live
+            // evaluation step at a time, counting document frequencies (if
+            // `labels` is given) and recording hashes (if `hashes` is given)
+            void _count_docs(
+                const vector <string_view>& docs,
+                const vector <char>& selected,
+                const vector <size_t>* labels,
+                vector <vector <uint64_t>>* hashes
             );
 
-            // compute weight of each term
+            // remove infrequent phrases from _counter, and freeze tables
+            void _finish_counting();
+
+            // convert scanned hashes into table indices (parsing docs again,
+            // to compare keys found by hash)
+            void _resolve(
+                const vector <string_view>& docs,
+                Scan& scan
+            ) const;
+
+            // compute weight of each term (tokenizing docs whose indices
+            // weren't kept)
             void _compute_weights(
-                const vector <string>& docs,
+                const vector <string_view>& docs,
                 const vector <size_t>& labels,
-                const vector <char>& insert_me
+                const Scan& scan
+            );
+
+            // compute weight of each term, from document frequencies
+            // (doc_freq[index * num_classes + class_num])
+            template <class V>
+            void _compute_weights(
+                const vector <size_t>& docs_in_class,
+                const V& doc_freq
             );
 
             // make features, used in dense vectorization
             void _make_features(
-                const vector <string>& docs
+                const vector <string_view>& docs,
+                const Scan& scan
             );
 
+            // keep only the largest terms of a (normalized) feature, and
+            // renormalize it, returning the L2 distance it moved
+            float _cap_feature(utils::Sparse& feature) const;
+
             // ===============================================================
             // text preprocessing
 
-            // break document into vector of phrases
-            vector <string> _break_into_phrases(const string& doc) const; // document -> vector of phrases
+            // reusable buffers for breaking documents into table keys
+            struct Tokenizer {
+
+                // id of words not in _words
+                static constexpr uint32_t unknown = UINT32_MAX;
+
+                // constructor
+                Tokenizer(const VHash& vhash):
+                    phrases(vhash._smallest_ngram, vhash._largest_ngram) {}
+
+                // phrases in document
+                utils::text::Phrases phrases;
+
+                // id of each word in document (only used if interning words)
+                vector <uint32_t> ids;
+
+                // hash of each word in document (only set when adding words
+                // to a table)
+                vector <uint64_t> hashes;
+
+                // hash of each key in document (only set when counting
+                // document frequencies in a sketch)
+                vector <uint64_t> key_hashes;
+
+                // sorted table index of each phrase in document (found in
+                // _table), with repeats
+                vector <uint32_t> indices;
+            };
+
+            // parse document
+            //
+            // if interning words, words are looked up in _words, or (if
+            // `words` is given) added to `words`, recording their hashes
+            void _tokenize(
+                const string_view& doc,
+                Tokenizer& tokenizer,
+                utils::Table* words = nullptr
+            ) const;
+
+            // call `func(key)` for the table key of each phrase in document
+            template <class F>
+            void _for_each_key(const Tokenizer& tokenizer, F&& func) const;
+
+            // parse document, and find the table index of each phrase
+            //
+            // cost is proportional to the number of phrases in the document
+            // (not the size of the table)
+            void _find_indices(const string_view& doc, Tokenizer& tokenizer) const;
+
+            // find the table index of each phrase in a tokenized document
+            void _lookup(Tokenizer& tokenizer) const;
+
+            // get table key for a phrase (empty if a word isn't in _words)
+            string _key(const string_view& phrase);
+
+            // get phrase with given table index (inverse of _key)
+            string _phrase(const size_t& index) const;
+
+            // get views of docs
+            static vector <string_view> _views(const vector <string>& docs);
+
+            // convert lines of label text to class numbers (in sorted order of labels)
+            static vector <size_t> _class_labels(const vector <string_view>& labels);
 
             // ===============================================================
             // table modification
 
-            // remove infrequent terms from table
-            void _remove_infreq(const size_t& thresh);
+            // count phrases in document, recording the hash of each table key
+            // (or, if interning words, of each word) in `hashes`, and (if
+            // counting document frequencies) counting the document in
+            // class `label`
+            void _count(
+                const string_view& doc,
+                Tokenizer& tokenizer,
+                Counter& counter,
+                vector <uint64_t>& hashes,
+                const size_t& label = 0
+            ) const;
 
-            // assign each term in table a sequential index
-            void _assign_indices();
+            // add counts from another counter into _counter
+            void _merge(const Counter& shard);
+
+            // replace each packed word id in key with `new_ids[id]`
+            static void _renumber_words(string& key, const vector <uint32_t>& new_ids);
+
+            // remove words that aren't in any phrase, and renumber the rest
+            void _remove_unused_words();
 
             // ===============================================================
             // vectorization
 
-            utils::Sparse _vectorize(const string& doc);
+            // vectorize document (log counts of each phrase)
+            utils::Sparse _vectorize(const string_view& doc);
+
+            // vectorize document, reusing a tokenizer
+            utils::Sparse _vectorize(const string_view& doc, Tokenizer& tokenizer);
+
+            // vectorize document, from the sorted indices of its phrases
+            utils::Sparse _vectorize(const vector <uint32_t>& indices) const;
+
+            // transform docs, reusing scanned documents (if given)
+            vector <vector <float>> _transform(
+                const vector <string_view>& docs,
+                const Scan* scan
+            );
+
+            // transform docs into a buffer (of float, half-precision bits, or
+            // int8), reusing scanned documents (if given)
+            template <class T>
+            void _transform(
+                const vector <string_view>& docs,
+                T* out,
+                const size_t& row_stride,
+                const Scan* scan
+            );
+
+            // weight and normalize phrases, from their sorted indices
+            utils::Sparse _weigh(const vector <uint32_t>& indices) const;
+
+            // weight and normalize phrases, from their sorted indices,
+            // writing the index and value of each distinct phrase into
+            // buffers (with room for `indices.size()` values), and returning
+            // the number written
+            template <class I>
+            size_t _weigh(
+                const vector <uint32_t>& indices,
+                I* out_indices,
+                float* out_values
+            ) const;
+
+            // take dot product of weighted document with each feature,
+            // writing into `row` (using `sums`, with a value for each feature,
+            // as scratch space if quantizing as int8)
+            void _scatter(const utils::Sparse& weighted, float* row, int32_t* sums) const;
+
+            // quantize postings values and weights (if quantizing)
+            void _quantize_features();
 
             // ===============================================================
             // tests
@@ -166,6 +850,27 @@ namespace vhash {
             static void _test_vectorization();
             static void _test_transform();
             static void _test_null();
+            static void _test_refit();
+            static void _test_intern_words();
+            static void _test_parallel_transform();
+            static void _test_parallel_fit();
+            static void _test_postings();
+            static void _test_sparse_vectorization();
+            static void _test_single_scan();
+            static void _test_memory_budget();
+            static void _test_partial_fit();
+            static void _test_files();
+            static void _test_save_load();
+            static void _test_stats();
+            static void _test_memory_usage();
+            static void _test_quantize();
+            static void _test_feature_capping();
+            static void _test_transform_sparse();
+            static void _test_concurrency();
+
+            // more (and longer) documents, for testing parallelization
+            static vector <string> _get_many_test_docs(const size_t& num_docs);
     };
 }
+#include <vhash/vhash.hxx>
 #endif
@@ -0,0 +1,160 @@
+#ifdef VHASH_VHASH_H
+
+#include <cmath>
+#include <type_traits>
+
+#include <utils/parallel.h>
+
+template <class F>
+void vhash::VHash::_for_each_key(const Tokenizer& tokenizer, F&& func) const {
+
+    // phrases are keyed by their text
+    if (!_intern_words) {
+        tokenizer.phrases.for_each(func);
+        return;
+    }
+
+    // phrases are keyed by the ids of their words, packed back-to-back
+    const vector <uint32_t>& ids = tokenizer.ids;
+    for (size_t first = 0; first < ids.size(); first++) {
+        for (size_t len = 1; len <= _largest_ngram && first + len <= ids.size(); len++) {
+            if (ids[first + len - 1] == Tokenizer::unknown) {break;}
+            if (len < _smallest_ngram) {continue;}
+            func(string_view((const char*)&ids[first], len * sizeof(uint32_t)));
+        }
+    }
+}
+
+template <class V>
+void vhash::VHash::_compute_weights(
+    const vector <size_t>& docs_in_class,
+    const V& doc_freq
+) {
+    // resize weights
+    size_t num_classes = docs_in_class.size();
+    vector <float> weights(_table.size());
+
+    // compute phrase weights
+    for (size_t phrase_index = 0; phrase_index < _table.size(); phrase_index++) {
+
+        // get overall document frequency
+        float overall_doc_freq = 0;
+        for (size_t class_num = 0; class_num < num_classes; class_num++) {
+            overall_doc_freq += doc_freq[phrase_index * num_classes + class_num];
+        }
+
+        // get expected occurrence for each class, if phrases were evenly distributed
+        float expected_occurrence = overall_doc_freq / _num_docs;
+
+        // add in contributing term from each class
+        for (size_t class_num = 0; class_num < num_classes; class_num++) {
+            if (!docs_in_class[class_num]) {continue;}
+            float actual_occurrence = doc_freq[phrase_index * num_classes + class_num] / (float)docs_in_class[class_num];
+            float difference_from_expectation = (expected_occurrence - actual_occurrence) / expected_occurrence;
+            weights[phrase_index] += pow(difference_from_expectation, 2);
+        }
+
+        // take sqrt to make euclidean
+        weights[phrase_index] = sqrt(weights[phrase_index]);
+    }
+    _weights = std::move(weights);
+}
+
+template <class T>
+void vhash::VHash::_transform(
+    const vector <string_view>& docs,
+    T* out,
+    const size_t& row_stride,
+    const Scan* scan
+) {
+    // split docs into chunks of similar length
+    size_t num_threads = utils::parallel::num_threads(_n_jobs);
+    vector <size_t> doc_sizes(docs.size());
+    for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+        doc_sizes[doc_num] = docs[doc_num].size() + 1;
+    }
+    vector <size_t> chunks = utils::parallel::split(doc_sizes, num_threads);
+
+    // scratch rows for each thread (float rows are only needed to convert output)
+    constexpr bool convert = !std::is_same <T, float>::value;
+    bool quantized = _quantize == Quantize::int8;
+    vector <vector <float>> rows(num_threads, vector <float>(convert? _features_size: 0));
+    vector <vector <int32_t>> sums(num_threads, vector <int32_t>(quantized? _features_size: 0));
+
+    // transform chunks in parallel
+    vector <Tokenizer> tokenizers(num_threads, Tokenizer(*this));
+    utils::parallel::for_each(chunks.size() - 1, num_threads, [&](const size_t& chunk, const size_t& thread) {
+        for (size_t doc_num = chunks[chunk]; doc_num < chunks[chunk + 1]; doc_num++) {
+            VHASH_STATS_LATENCY(_stats);
+            VHASH_STATS_ADD(_stats, docs_transformed, 1);
+
+            // find phrases (unless kept while fitting)
+            bool scanned = scan && scan->kept(doc_num);
+            if (!scanned) {_find_indices(docs[doc_num], tokenizers[thread]);}
+            const vector <uint32_t>& indices = scanned? scan->indices[doc_num]: tokenizers[thread].indices;
+
+            // weight phrases
+            utils::Sparse weighted;
+            {
+                VHASH_STATS_TIME(_stats, vectorize);
+                weighted = _weigh(indices);
+            }
+
+            // scatter each phrase into the features that contain it
+            VHASH_STATS_TIME(_stats, scatter);
+            T* row = out + doc_num * row_stride;
+            if constexpr (!convert) {
+                _scatter(weighted, row, sums[thread].data());
+            }
+
+            // convert to output type
+            else {
+                float* values = rows[thread].data();
+                _scatter(weighted, values, sums[thread].data());
+                for (size_t feature_num = 0; feature_num < _features_size; feature_num++) {
+                    if constexpr (std::is_same <T, uint16_t>::value) {
+                        row[feature_num] = utils::quant::to_half(values[feature_num]);
+                    }
+                    else {
+                        row[feature_num] = utils::quant::to_int8(values[feature_num], 1 / 127.f);
+                    }
+                }
+            }
+        }
+    });
+}
+
+template <class I>
+size_t vhash::VHash::_weigh(
+    const vector <uint32_t>& indices,
+    I* out_indices,
+    float* out_values
+) const {
+
+    // log count of each run of a phrase, times its weight
+    size_t num_nonzero = 0;
+    for (size_t start = 0, end = 0; start < indices.size(); start = end) {
+        while (end < indices.size() && indices[end] == indices[start]) {end++;}
+        uint32_t index = indices[start];
+        float value = std::log(1 + end - start);
+        if (_quantize == Quantize::none) {value *= _weights[index];}
+        else {value *= utils::quant::from_half(_weights_half[index]);}
+        out_indices[num_nonzero] = index;
+        out_values[num_nonzero++] = value;
+    }
+
+    // normalize
+    float norm = 0;
+    for (size_t g = 0; g < num_nonzero; g++) {
+        norm += std::pow(out_values[g], 2);
+    }
+    norm = std::sqrt(norm);
+    if (norm != 0) {
+        for (size_t g = 0; g < num_nonzero; g++) {
+            out_values[g] /= norm;
+        }
+    }
+    return num_nonzero;
+}
+
+#endif
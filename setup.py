@@ -1,5 +1,5 @@
 from glob import glob
-from os import path
+from os import environ, path
 from setuptools import find_packages, setup
 
 from pybind11.setup_helpers import build_ext, Pybind11Extension
@@ -8,11 +8,17 @@ from pybind11.setup_helpers import build_ext, Pybind11Extension
 # setup script
 if __name__ == '__main__':
 
-    # get files
-    cxx_files = glob('cxx/utils/*.cxx')
+    # get files (leaving out benchmarking helpers)
+    cxx_files = [
+        file for file in glob('cxx/utils/*.cxx')
+        if path.basename(file) != 'bench.cxx'
+    ]
     cxx_files.extend(glob('cxx/vhash/*.cxx'))
     cxx_files.append('cxx/pybind.cxx')
 
+    # collect stats, if requested (VHASH_STATS=1 pip install .)
+    define_macros = [('VHASH_STATS', None)] if environ.get('VHASH_STATS') else []
+
     # run setup
     setup(
 
@@ -58,6 +64,9 @@ if __name__ == '__main__':
                 "_vhash",
                 cxx_files,
                 include_dirs=[path.join(path.dirname(__file__), 'cxx')],
+                define_macros=define_macros,
+                extra_compile_args=['-pthread'],
+                extra_link_args=['-pthread'],
             ),
         ]
     )
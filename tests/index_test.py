@@ -0,0 +1,74 @@
+from __future__ import annotations
+
+from threading import Thread
+
+from numpy import arange, float32, int64
+
+from vhash import VHash, VHashIndex
+
+
+def get_model() -> tuple[VHash, list[str]]:
+    docs = [
+        'hi, my name is Mike',
+        'hi, my name is George',
+        'hello, my name is Mike',
+    ]
+    labels = [1, 0, 1]
+    return VHash().fit(docs, labels), docs
+
+
+def test_query():
+    model, docs = get_model()
+    index = VHashIndex(model).add(docs)
+    assert(len(index) == len(docs))
+    ids, scores = index.query(docs, k=2)
+    assert(ids.shape == (3, 2) and ids.dtype == int64)
+    assert(scores.shape == (3, 2) and scores.dtype == float32)
+    transformed = model.transform(docs)
+    for doc_num in range(len(docs)):
+        similarities = transformed @ transformed[doc_num]
+        assert(abs(scores[doc_num] - similarities[ids[doc_num]]).max() < 1E-5)
+        assert(scores[doc_num, 0] >= similarities.max() - 1E-5)
+        assert(scores[doc_num, 0] >= scores[doc_num, 1])
+    assert(index.query(docs, k=10)[0].shape == (3, 3))
+
+
+def test_query_vectors():
+    model, docs = get_model()
+    vectors = (arange(30, dtype=float32).reshape(10, 3) % 7) / 7
+    for quantize in ['none', 'int8']:
+        index = VHashIndex(model, quantize=quantize).add_vectors(vectors)
+        ids, scores = index.query_vectors(vectors, k=1)
+        expected = (vectors @ vectors.T).max(axis=1)
+        assert(abs(scores[:, 0] - expected).max() < 0.1)
+        index.build(num_lists=3)
+        assert(index.num_lists == 3)
+        assert((index.query_vectors(vectors, k=1, num_probes=3)[1] == scores).all())
+    try:
+        VHashIndex(model, quantize='fp16')
+        assert(False)
+    except ValueError:
+        pass
+
+
+def test_threads():
+    model, docs = get_model()
+    index = VHashIndex(model).add(docs)
+
+    # add on one thread, while querying on another
+    def add():
+        for _ in range(100):
+            index.add(docs)
+    adder = Thread(target=add)
+    adder.start()
+    for _ in range(100):
+        ids, _ = index.query(docs, k=2)
+        assert((ids >= 0).all())
+    adder.join()
+    assert(len(index) == 101 * len(docs))
+
+
+if __name__ == '__main__':
+    test_query()
+    test_query_vectors()
+    test_threads()
@@ -0,0 +1,49 @@
+from __future__ import annotations
+
+from numpy import float32
+
+from vhash import VHash, VHashPipeline
+
+
+def test_transform():
+    docs = [
+        'hi, my name is Mike',
+        'hi, my name is George',
+        'hello, my name is Mike',
+    ]
+    labels = [1, 0, 1]
+    model = VHash().fit(docs, labels)
+    expected = model.transform(docs * 10)
+    for batch_size in [1, 4, 100]:
+        pipeline = VHashPipeline(model, batch_size=batch_size, num_batches=3)
+        transformed = pipeline.transform(docs * 10)
+        assert(transformed.dtype == float32)
+        assert((transformed == expected).all())
+    try:
+        VHashPipeline(model, num_batches=2)
+        assert(False)
+    except ValueError:
+        pass
+
+
+def test_stats():
+    docs = [
+        'hi, my name is Mike',
+        'hi, my name is George',
+        'hello, my name is Mike',
+    ]
+    model = VHash().fit(docs, [1, 0, 1])
+    pipeline = VHashPipeline(model, batch_size=2)
+    pipeline.transform(docs * 100)
+    stats = pipeline.stats()
+    assert(stats['num_docs'] == 300)
+    assert(stats['docs_per_second'] > 0)
+    assert(list(stats['stages']) == ['tokenize', 'lookup', 'project'])
+    for stage in stats['stages'].values():
+        assert(0 <= stage['utilization'] <= 1)
+        assert(stage['max_queue_depth'] <= pipeline.num_batches)
+
+
+if __name__ == '__main__':
+    test_transform()
+    test_stats()
@@ -1,13 +1,21 @@
 from __future__ import annotations
 
 from copy import deepcopy
+from ctypes import CDLL
 from math import isclose
+from os import path
+from tempfile import TemporaryDirectory
+from threading import Thread
 from typing import Any
 
 from nptyping import NDArray
+from numpy import float16, float32, int8, shares_memory, vstack, zeros
 
 from vhash import VHash
 
+# C library, whose rand() picks the docs that become features
+libc = CDLL(None)
+
 
 def get_data() -> tuple[list[str], list[int]]:
     docs = [
@@ -42,6 +50,157 @@ def test_fit_transform():
     check_result(transformed)
 
 
+def test_intern_words():
+    docs, labels = get_data()
+    transformed = VHash(intern_words=True).fit_transform(docs, labels)
+    check_result(transformed)
+    assert((abs(transformed - VHash().fit_transform(docs, labels)) < 1E-6).all())
+
+
+def test_n_jobs():
+    docs, labels = get_data()
+    docs = docs * 10000
+    labels = labels * 10000
+    libc.srand(0)
+    transformed = VHash(num_features=3).fit(docs, labels).transform(docs)
+    libc.srand(0)
+    model = VHash(num_features=3, n_jobs=4).fit(docs, labels)
+    parallel = model.transform(docs)
+    assert((deepcopy(model).transform(docs) == parallel).all())
+    assert(parallel.shape == transformed.shape)
+    assert((abs(parallel - transformed) < 1E-6).all())
+    try:
+        VHash(n_jobs=0)
+        assert(False)
+    except ValueError:
+        pass
+
+
+def test_partial_fit():
+    docs, labels = get_data()
+    model = VHash()
+    for doc, label in zip(docs, labels):
+        model.partial_fit([doc], [label])
+    check_result(model.finalize().transform(docs))
+    try:
+        VHash().partial_fit(docs, [])
+        assert(False)
+    except ValueError:
+        pass
+
+
+def test_memory_budget():
+    docs, labels = get_data()
+    transformed = VHash(memory_budget=1 << 16).fit_transform(docs, labels)
+    check_result(transformed)
+
+
+def test_transform_out():
+    docs, labels = get_data()
+    model = VHash().fit(docs, labels)
+    transformed = model.transform(docs)
+    assert(transformed.dtype == float32)
+    buffer = zeros((5, 3), dtype=float32)
+    result = model.transform(docs, out=buffer[2:])
+    assert(shares_memory(result, buffer))
+    assert((buffer[2:] == transformed).all())
+    assert((buffer[:2] == 0).all())
+    for bad in [zeros((3, 3)), zeros((2, 3), dtype=float32), zeros((3, 6), dtype=float32)[:, ::2]]:
+        try:
+            model.transform(docs, out=bad)
+            assert(False)
+        except ValueError:
+            pass
+
+
+def test_files():
+    docs, labels = get_data()
+    with TemporaryDirectory() as directory:
+        docs_path = path.join(directory, 'docs.txt')
+        labels_path = path.join(directory, 'labels.txt')
+        with open(docs_path, 'w') as file:
+            file.write('\n'.join(docs) + '\n')
+        with open(labels_path, 'w') as file:
+            file.write('\n'.join(map(str, labels)))
+        model = VHash().fit_file(docs_path, labels_path)
+        transformed = model.transform_file(docs_path, path.join(directory, 'out.npy'))
+        check_result(transformed)
+        assert((transformed == VHash().fit(docs, labels).transform(docs)).all())
+        del transformed
+        unlabeled = VHash().fit_file(docs_path).transform(docs)
+        one_class = VHash().fit(docs, [0] * len(docs)).transform(docs)
+        assert((unlabeled == one_class).all())
+
+
+def test_memory_usage():
+    docs, labels = get_data()
+    usage = VHash().fit(docs, labels).memory_usage()
+    assert(usage['weights'] > 0)
+    assert(usage['total'] == sum(
+        bytes for component, bytes in usage.items() if component != 'total'
+    ))
+
+
+def test_stats():
+    docs, labels = get_data()
+    model = VHash().fit(docs, labels).reset_stats()
+    model.transform(docs)
+    stats = model.stats()
+    transformed = sum(stats['latency_histogram'])
+    if stats['enabled']:
+        assert(stats['counts']['docs_transformed'] == len(docs))
+        assert(transformed == len(docs))
+    else:
+        assert(transformed == 0)
+        assert(all(value == 0 for value in stats['counts'].values()))
+
+
+def test_save_load():
+    docs, labels = get_data()
+    model = VHash(intern_words=True).fit(docs, labels)
+    with TemporaryDirectory() as directory:
+        model_path = path.join(directory, 'model.vhash')
+        model.save(model_path)
+        loaded = VHash.load(model_path)
+        assert(type(loaded) is VHash)
+        assert((loaded.transform(docs) == model.transform(docs)).all())
+
+
+def test_quantize():
+    docs, labels = get_data()
+    model = VHash().fit(docs, labels)
+    transformed = model.transform(docs)
+    for quantize, tolerance in [('fp16', 1E-2), ('int8', 5E-2)]:
+        quantized = VHash(quantize=quantize).fit(docs, labels).transform(docs)
+        assert(abs(quantized - transformed).max() < tolerance)
+    half = model.transform(docs, dtype='float16')
+    assert(half.dtype == float16)
+    assert(abs(half - transformed).max() < 1E-3)
+    quantized = model.transform(docs, out=zeros((3, 3), dtype=int8))
+    assert(abs(quantized / 127 - transformed).max() <= 0.5 / 127 + 1E-6)
+    try:
+        VHash(quantize='int4')
+        assert(False)
+    except ValueError:
+        pass
+
+
+def test_feature_capping():
+    docs, labels = get_data()
+    assert((VHash().fit(docs, labels).feature_errors() == 0).all())
+    model = VHash(max_feature_terms=2).fit(docs, labels)
+    errors = model.feature_errors()
+    assert(len(errors) == model.transform(docs).shape[1])
+    assert((errors > 0).any())
+    model = VHash(feature_mass=0.5).fit(docs, labels)
+    assert((model.feature_errors() <= (2 - 2 * 0.5 ** 0.5) ** 0.5 + 1E-4).all())
+    try:
+        VHash(feature_mass=0)
+        assert(False)
+    except ValueError:
+        pass
+
+
 def test_pickle():
     docs, labels = get_data()
     model = VHash().fit(docs, labels)
@@ -50,9 +209,81 @@ def test_pickle():
     model = None
     transformed2 = model2.transform(docs)
     assert((transformed == transformed2).all())
+    model = VHash(intern_words=True).fit(docs, labels)
+    assert((model.transform(docs) == deepcopy(model).transform(docs)).all())
+    assert(type(model.__getstate__()) is bytes)
+
+
+def test_transform_iter():
+    docs, labels = get_data()
+    vhash = VHash().fit(docs, labels)
+    expected = vhash.transform(docs * 5)
+    for batch_size in [1, 4, 100]:
+        blocks = list(vhash.transform_iter(iter(docs * 5), batch_size))
+        assert(len(blocks) == -(-len(docs) * 5 // batch_size))
+        assert(all(len(block) <= batch_size for block in blocks))
+        assert((vstack(blocks) == expected).all())
+    blocks = vhash.transform_iter((doc for doc in docs), 2, dtype='int8')
+    assert(next(blocks).dtype == int8)
+    assert(list(vhash.transform_iter([], 10)) == [])
+    try:
+        next(vhash.transform_iter(docs, 0))
+        assert(False)
+    except ValueError:
+        pass
+
+
+def test_transform_sparse():
+    docs, labels = get_data()
+    vhash = VHash().fit(docs, labels)
+    data, indices, indptr = vhash.transform_sparse(docs + ['unseen'])
+    assert(data.dtype == float32)
+    assert(indices.dtype == int32)
+    assert(indptr.dtype == int64)
+    assert(len(indptr) == len(docs) + 2)
+    assert(indptr[0] == 0 and indptr[-1] == len(data) == len(indices))
+    assert(indptr[-2] == indptr[-1])
+    assert((indices >= 0).all() and (indices < vhash.num_phrases()).all())
+    for doc_num in range(len(docs)):
+        row = data[indptr[doc_num]:indptr[doc_num + 1]]
+        assert(isclose((row ** 2).sum(), 1, abs_tol=1E-5))
+
+
+def test_threads():
+    docs, labels = get_data()
+    docs = docs * 1000
+    labels = labels * 1000
+    libc.srand(0)
+    vhash = VHash(num_features=3).fit(docs, labels)
+    expected = vhash.transform(docs)
+
+    # refit (to the same model) on one thread, while transforming on another
+    def fit():
+        for _ in range(20):
+            libc.srand(0)
+            vhash.fit(docs, labels)
+    fitter = Thread(target=fit)
+    fitter.start()
+    for _ in range(100):
+        assert((abs(vhash.transform(docs) - expected) < 1E-6).all())
+    fitter.join()
 
 
 if __name__ == '__main__':
     test_fit()
     test_fit_transform()
+    test_intern_words()
+    test_n_jobs()
+    test_partial_fit()
+    test_memory_budget()
+    test_transform_out()
+    test_files()
+    test_memory_usage()
+    test_stats()
+    test_save_load()
+    test_quantize()
+    test_feature_capping()
     test_pickle()
+    test_transform_iter()
+    test_transform_sparse()
+    test_threads()
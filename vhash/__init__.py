@@ -1,3 +1,5 @@
 """Vectorizing hash table for fast quantization of text documents"""
 
+from vhash.index import VHashIndex
+from vhash.pipeline import VHashPipeline
 from vhash.vhash import VHash
@@ -0,0 +1,176 @@
+"""Top-k similarity search over documents transformed by a VHash model"""
+
+from __future__ import annotations
+from typing import Any
+
+from nptyping import NDArray
+from numpy import float32, int64
+
+from _vhash import VHashIndex as _VHashIndex
+from vhash.vhash import VHash
+
+
+class VHashIndex(_VHashIndex):
+    """Index of transformed documents, for top-k similarity search
+
+    Stores the transformed vector of each added document in one contiguous
+    array, and finds the stored documents with the largest dot products with
+    each query. This replaces pushing transformed vectors into a separate
+    similarity service.
+
+    By default, queries compare against every stored document. After
+    :code:`build()`, stored documents are also grouped into lists around
+    centroids (an inverted file index), and queries can instead search just
+    the :code:`num_probes` lists whose centroids are closest to them, which
+    is much faster for millions of documents, but may miss some results.
+
+    Parameters
+    ----------
+    model: VHash
+        fitted model, used to transform documents (the index keeps its own
+        copy)
+    quantize: str, optional, default='none'
+        how to store vectors: :code:`'none'` (float32), or :code:`'int8'`
+        (8-bit integers, with a scale for each document, in about a quarter
+        of the memory). With :code:`'int8'`, queries are quantized too, and
+        scores are close to, but not exactly, the dot products.
+    n_jobs: int, optional, default=1
+        number of threads to use when querying and building (as for
+        :code:`VHash`)
+    """
+
+    def __init__(
+        self,
+        /,
+        model: VHash,
+        quantize: str = 'none',
+        n_jobs: int = 1,
+    ):
+        _VHashIndex.__init__(self, model, quantize, n_jobs)
+
+    def add(self, /, docs: list[str]) -> VHashIndex:
+        """Transform docs, and add them to the index
+
+        Documents are numbered in the order they're added.
+
+        Parameters
+        ----------
+        docs: list[str]
+            documents to add
+
+        Returns
+        -------
+        VHashIndex
+            Calling instance
+        """
+        if type(docs) is str:
+            docs = [docs]
+        _VHashIndex.add(self, docs)
+        return self
+
+    def add_vectors(
+        self,
+        /,
+        vectors: NDArray[(Any, Any), float32],
+    ) -> VHashIndex:
+        """Add transformed vectors to the index
+
+        Parameters
+        ----------
+        vectors: NDArray([Any, Any], float32)
+            vectors, of shape :code:`(num_vectors, dimension)`
+
+        Returns
+        -------
+        VHashIndex
+            Calling instance
+        """
+        _VHashIndex.add_vectors(self, vectors)
+        return self
+
+    def build(
+        self,
+        /,
+        num_lists: int,
+        iterations: int = 10,
+    ) -> VHashIndex:
+        """Group stored documents into lists, for approximate search
+
+        Runs spherical k-means over the stored vectors. Documents added later
+        are put into the list of their closest centroid. A good starting
+        point is around :code:`sqrt(len(index))` lists.
+
+        Parameters
+        ----------
+        num_lists: int
+            number of lists (at most the number of stored documents)
+        iterations: int, optional, default=10
+            number of k-means iterations
+
+        Returns
+        -------
+        VHashIndex
+            Calling instance
+        """
+        _VHashIndex.build(self, num_lists, iterations)
+        return self
+
+    def query(
+        self,
+        /,
+        docs: list[str],
+        k: int = 10,
+        num_probes: int = 0,
+    ) -> tuple[NDArray[(Any, Any), int64], NDArray[(Any, Any), float32]]:
+        """Find the stored documents most similar to each doc
+
+        Parameters
+        ----------
+        docs: list[str]
+            documents to query
+        k: int, optional, default=10
+            number of results per doc (capped at the number of stored
+            documents)
+        num_probes: int, optional, default=0
+            number of lists to search (if built). If 0, or at least the
+            number of lists, every stored document is searched.
+
+        Returns
+        -------
+        ids: NDArray([Any, Any], int64)
+            ids of the most similar stored documents for each doc, from most
+            to least similar (padded with -1, if the searched lists hold
+            fewer than :code:`k` documents)
+        scores: NDArray([Any, Any], float32)
+            their dot products with each doc (padded with -inf)
+        """
+        if type(docs) is str:
+            docs = [docs]
+        return _VHashIndex.query(self, docs, k, num_probes)
+
+    def query_vectors(
+        self,
+        /,
+        vectors: NDArray[(Any, Any), float32],
+        k: int = 10,
+        num_probes: int = 0,
+    ) -> tuple[NDArray[(Any, Any), int64], NDArray[(Any, Any), float32]]:
+        """Find the stored documents most similar to each transformed vector
+
+        Parameters
+        ----------
+        vectors: NDArray([Any, Any], float32)
+            query vectors, of shape :code:`(num_vectors, dimension)`
+        k: int, optional, default=10
+            number of results per vector (as in :code:`query()`)
+        num_probes: int, optional, default=0
+            number of lists to search (as in :code:`query()`)
+
+        Returns
+        -------
+        ids: NDArray([Any, Any], int64)
+            ids of the most similar stored documents (as in :code:`query()`)
+        scores: NDArray([Any, Any], float32)
+            their dot products with each vector
+        """
+        return _VHashIndex.query_vectors(self, vectors, k, num_probes)
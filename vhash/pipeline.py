@@ -0,0 +1,87 @@
+"""Transforming documents in a pipeline of concurrent stages"""
+
+from __future__ import annotations
+from typing import Any
+
+from nptyping import NDArray
+from numpy import float32
+
+from _vhash import VHashPipeline as _VHashPipeline
+from vhash.vhash import VHash
+
+
+class VHashPipeline(_VHashPipeline):
+    """Pipeline for transforming documents, with overlapping stages
+
+    Documents are grouped into batches, which flow through three stages,
+    each running on its own thread: :code:`tokenize` (parse each document
+    into phrases), :code:`lookup` (find and weight each phrase), and
+    :code:`project` (take the dot product with each feature). Stages are
+    connected by bounded lock-free queues, so tokenizing one batch overlaps
+    projecting the one before it.
+
+    After each transform, :code:`stats()` shows the throughput, and how busy
+    each stage was, to find the stage that limits it.
+
+    Parameters
+    ----------
+    model: VHash
+        fitted model, used to transform documents (the pipeline keeps its own
+        copy)
+    batch_size: int, optional, default=64
+        number of documents in each batch
+    num_batches: int, optional, default=8
+        number of batches in flight (at least 3, so every stage can work at
+        once)
+    """
+
+    def __init__(
+        self,
+        /,
+        model: VHash,
+        batch_size: int = 64,
+        num_batches: int = 8,
+    ):
+        _VHashPipeline.__init__(self, model, batch_size, num_batches)
+
+    def transform(self, /, docs: list[str]) -> NDArray[(Any, Any), float32]:
+        """Transform docs
+
+        Output matches :code:`VHash.transform()`. The GIL is released while
+        transforming.
+
+        Parameters
+        ----------
+        docs: list[str]
+            documents to transform
+
+        Returns
+        -------
+        NDArray([Any, Any], float32)
+            transformed documents, of shape :code:`(len(docs), num_features)`
+        """
+        if type(docs) is str:
+            docs = [docs]
+        return _VHashPipeline.transform(self, docs)
+
+    def stats(self, /) -> dict:
+        """Throughput and stage stats of the last transform
+
+        Returns
+        -------
+        dict
+            with keys:
+
+            * :code:`num_docs`: number of documents transformed
+            * :code:`seconds`: wall-clock duration
+            * :code:`docs_per_second`: throughput
+            * :code:`stages`: for each stage (:code:`tokenize`,
+              :code:`lookup`, :code:`project`), a dict of
+              :code:`busy_seconds` (time spent working, not waiting),
+              :code:`utilization` (busy fraction of the duration), and
+              :code:`mean_queue_depth` and :code:`max_queue_depth` (batches
+              waiting for the stage, each time it took one). The stage that
+              saturates has high utilization, with batches queued in front
+              of it.
+        """
+        return _VHashPipeline.stats(self)
@@ -1,10 +1,12 @@
 """Vectorizing hash table for fast quantization of text documents"""
 
 from __future__ import annotations
-from typing import Any
+from concurrent.futures import ThreadPoolExecutor
+from itertools import islice
+from typing import Any, Iterable, Iterator
 
 from nptyping import NDArray
-from numpy import array, unique, zeros
+from numpy import array, float32, int32, int64, load, unique, zeros
 
 from _vhash import VHash as _VHash
 
@@ -48,6 +50,68 @@ class VHash(_VHash):
         Minimum number of words to take as a single phrase. This table's
         vocabulary will consist of phrases from :code:`smallest_ngram`-words
         long to :code:`largest_ngram`-words long.
+    intern_words: bool, optional, default=False
+        If True, each word is assigned a 32-bit id, and each phrase is stored
+        as the packed ids of its words, rather than as text. This makes the
+        vocabulary smaller, and makes table lookups faster, as each word is
+        only hashed once per document (instead of once per phrase it's in).
+    n_jobs: int, optional, default=1
+        number of threads to use when fitting and transforming. Negative
+        values count back from the number of cores (e.g. :code:`-1` uses all
+        cores), and 0 raises :code:`ValueError`. Documents are split into chunks of similar total length, and
+        idle threads steal chunks from busy ones. When fitting, each thread
+        counts phrases into its own table, and tables are merged before each
+        live evaluation, so the learned phrases and weights are the same as
+        for single-threaded fits.
+    memory_budget: int, optional, default=0
+        maximum memory (in bytes) to use when counting phrases while
+        fitting. If 0, phrases are counted exactly, and the table of counts
+        grows until each live evaluation. Otherwise, every phrase is counted
+        approximately in a fixed-size Count-Min sketch, and only phrases
+        whose estimated count is high enough are kept as candidates for the
+        vocabulary. When candidates exceed the budget, the least frequent
+        half is evicted, and later phrases must beat their counts to be
+        admitted. Phrases well above :code:`min_phrase_occurrence` are
+        kept just as when counting exactly; phrases near it may be kept or
+        dropped, since counts can be overestimated. :code:`fit` then
+        tokenizes each document again (rather than keeping its phrases) to
+        count document frequencies exactly. With :code:`partial_fit`, each
+        class's document frequencies are counted exactly while a phrase is
+        a candidate, and otherwise (before it's admitted, or after it's
+        evicted) in a second sketch keyed by phrase and class, which is
+        added in when fitting finishes. Those frequencies can be
+        overestimated too, which pulls the weights of phrases that spent
+        part of the stream outside the table slightly towards zero.
+    quantize: str, optional, default='none'
+        how to store feature values and phrase weights once fitted:
+        :code:`'none'` (float32), :code:`'fp16'` (half precision, halving
+        their memory) or :code:`'int8'` (8-bit feature values, quartering
+        their memory, with weights in half precision). With :code:`'int8'`,
+        each feature's values are scaled by the largest of them, and
+        documents are quantized the same way when transformed, so features
+        are summed as integers. Results are close to, but not
+        exactly, those of an unquantized model (typically within 1E-2 for
+        :code:`'fp16'`, and a few hundredths for :code:`'int8'`).
+    max_feature_terms: int, optional, default=0
+        most terms to keep in each feature (0 keeps all of them). Features
+        are weighted vectorizations of training documents, so a long
+        document makes a feature with many terms, which every
+        :code:`transform` call has to intersect against. Capping keeps
+        only the largest-magnitude terms of each feature, and renormalizes
+        it, bounding the cost of transforming each document. The error this
+        introduces is reported by :code:`feature_errors()`.
+    feature_mass: float, optional, default=1
+        fraction of each feature's squared L2 norm to keep, in (0, 1]. Only
+        as many of the largest terms as are needed to hold this fraction are
+        kept (and no more than :code:`max_feature_terms`). Keeping a
+        fraction :code:`m` moves each feature by at most
+        :code:`sqrt(2 - 2 * sqrt(m))`.
+
+    Notes
+    -----
+    Models can be shared between threads. Fitting and transforming release
+    the GIL, and transforms wait for any fit in progress to finish (and vice
+    versa), so each sees the whole of one fitted model.
     """
 
     def fit(
@@ -70,10 +134,55 @@ class VHash(_VHash):
         VHash
             Calling instance
         """
-        class_labels = zeros(len(labels), dtype=int)
-        for class_num, label_value in enumerate(unique(labels)):
-            class_labels[labels == label_value] = class_num
-        _VHash.fit(self, docs, class_labels.tolist())
+        _VHash.fit(self, docs, self._class_labels(labels))
+        return self
+
+    def partial_fit(
+        self,
+        /,
+        docs: list[str],
+        labels: list
+    ) -> VHash:
+        """Count phrases in a batch of docs, to fit model incrementally
+
+        Phrase counts and per-class document frequencies are accumulated
+        across calls, and live evaluations happen every
+        :code:`live_evaluation_step` documents of the whole stream. Documents
+        for features are sampled uniformly from the stream (reservoir
+        sampling). Call :code:`finalize()` after the last batch.
+
+        :code:`downsample_to` is not applied: every document is counted.
+
+        Parameters
+        ----------
+        docs: list[str]
+            batch of documents to use to train model
+        labels: list
+            class label for each document (raises :code:`ValueError` if
+            there isn't one for each document)
+
+        Returns
+        -------
+        VHash
+            Calling instance
+        """
+        classes = self.__dict__.setdefault('_partial_classes', {})
+        class_labels = [classes.setdefault(label, len(classes)) for label in labels]
+        _VHash.partial_fit(self, docs, class_labels)
+        return self
+
+    def finalize(self, /) -> VHash:
+        """Finish fitting model from batches passed to :code:`partial_fit()`
+
+        Prunes infrequent phrases, computes weights, and makes features.
+
+        Returns
+        -------
+        VHash
+            Calling instance
+        """
+        _VHash.finalize(self)
+        self._partial_classes = {}
         return self
 
     def fit_transform(
@@ -81,7 +190,7 @@ class VHash(_VHash):
         /,
         docs: list[str],
         labels: list
-    ) -> NDArray[(Any, Any), float]:
+    ) -> NDArray[(Any, Any), float32]:
         """Fit model, get numeric representation of docs
 
         Parameters
@@ -93,32 +202,329 @@ class VHash(_VHash):
 
         Returns
         -------
-        numeric: NDArray([Any, Any], float)
+        numeric: NDArray([Any, Any], float32)
             Numeric representation of documents.
             :code:`rep[x]` is for :code:`docs[x]`.
             :code:`rep[x].size() == num_features` (set in constructor)
         """
-        return self.fit(docs, labels).transform(docs)
+        return _VHash.fit_transform(self, docs, self._class_labels(labels))
+
+    @staticmethod
+    def _class_labels(labels: list) -> list[int]:
+        """Convert class labels to class numbers (0, 1, ...)"""
+        class_labels = zeros(len(labels), dtype=int)
+        for class_num, label_value in enumerate(unique(labels)):
+            class_labels[labels == label_value] = class_num
+        return class_labels.tolist()
 
     def transform(
         self,
         /,
         docs: list[str],
-    ) -> NDArray[(Any, Any), float]:
+        out: NDArray[(Any, Any), Any] = None,
+        dtype: str = 'float32',
+    ) -> NDArray[(Any, Any), Any]:
         """Get numeric representation of docs
 
         Parameters
         ----------
         docs: list[str]
             documents to numerically represent
+        out: NDArray([Any, Any], Any), optional, default=None
+            array to write results into, e.g. a slice of a preallocated or
+            memory-mapped array. Must have shape
+            :code:`(len(docs), num_features)`, dtype :code:`float32`,
+            :code:`float16` or :code:`int8`, and contiguous rows. If None, a
+            new array is allocated.
+        dtype: str, optional, default='float32'
+            dtype of the allocated array (if :code:`out` is None):
+            :code:`'float32'`, :code:`'float16'` or :code:`'int8'`. Values
+            are in [0, 1], so :code:`int8` results are multiplied by 127 (and
+            rounded).
 
         Returns
         -------
-        numeric: NDArray([Any, Any], float)
-            Numeric representation of documents.
+        numeric: NDArray([Any, Any], Any)
+            Numeric representation of documents (:code:`out`, if provided).
             :code:`rep[x]` is for :code:`docs[x]`.
             :code:`rep[x].size() == num_features` (set in constructor)
         """
         if type(docs) is str:
             docs = [docs]
-        return array(_VHash.transform(self, docs))
+        return _VHash.transform(self, docs, out, dtype)
+
+    def transform_iter(
+        self,
+        /,
+        docs: Iterable[str],
+        batch_size: int = 10000,
+        dtype: str = 'float32',
+    ) -> Iterator[NDArray[(Any, Any), Any]]:
+        """Get numeric representation of a stream of docs, in blocks
+
+        Docs are consumed from any iterable (e.g. a generator reading a file
+        or database), :code:`batch_size` at a time, and a block of results is
+        yielded for each batch. Each batch is transformed on a background
+        thread, with the GIL released, while the next batch is gathered and
+        the previous block is used. Peak memory depends on the batch size,
+        not the number of docs.
+
+        Parameters
+        ----------
+        docs: Iterable[str]
+            documents to numerically represent
+        batch_size: int, optional, default=10000
+            number of documents in each block (the last may be smaller)
+        dtype: str, optional, default='float32'
+            dtype of each block (as in :code:`transform()`)
+
+        Yields
+        ------
+        numeric: NDArray([Any, Any], Any)
+            Numeric representation of each batch of documents, of shape
+            :code:`(len(batch), num_features)`, in order
+        """
+        if batch_size < 1:
+            raise ValueError(f'batch_size must be at least 1 (got {batch_size})')
+        if type(docs) is str:
+            docs = [docs]
+        docs = iter(docs)
+        with ThreadPoolExecutor(max_workers=1) as executor:
+            pending = None
+            while True:
+
+                # gather next batch, while the last one is transformed
+                batch = list(islice(docs, batch_size))
+
+                # start transforming it, then hand over the last block
+                block = pending.result() if pending is not None else None
+                pending = executor.submit(
+                    _VHash.transform, self, batch, None, dtype,
+                ) if batch else None
+                if block is not None:
+                    yield block
+                if pending is None:
+                    break
+
+    def transform_sparse(
+        self,
+        /,
+        docs: list[str],
+    ) -> tuple[
+        NDArray[(Any,), float32],
+        NDArray[(Any,), int32],
+        NDArray[(Any,), int64],
+    ]:
+        """Get weighted phrase vector of docs, in CSR format
+
+        These are the vectors that :code:`transform()` projects onto the
+        features: the log count of each phrase in the vocabulary, times its
+        weight, normalized to unit length. They're returned without being
+        projected, for consumers that want the terms themselves (e.g. linear
+        models, or rerankers). Columns are phrase numbers, so there are
+        :code:`num_phrases()` of them.
+
+        Parameters
+        ----------
+        docs: list[str]
+            documents to represent
+
+        Returns
+        -------
+        data: NDArray([Any], float32)
+            nonzero values of all rows, concatenated
+        indices: NDArray([Any], int32)
+            column of each value (sorted within each row)
+        indptr: NDArray([Any], int64)
+            row :code:`x` (for :code:`docs[x]`) is
+            :code:`data[indptr[x]:indptr[x+1]]` (so there are
+            :code:`len(docs) + 1` values)
+
+        Examples
+        --------
+        To get a :code:`scipy` sparse matrix:
+
+        .. code-block:: python
+
+            from scipy.sparse import csr_matrix
+
+            sparse = csr_matrix(
+                vhash.transform_sparse(docs),
+                shape=(len(docs), vhash.num_phrases()),
+            )
+        """
+        if type(docs) is str:
+            docs = [docs]
+        return _VHash.transform_sparse(self, docs)
+
+    def num_phrases(self, /) -> int:
+        """Number of phrases in the vocabulary
+
+        Returns
+        -------
+        int
+            number of phrases (columns of :code:`transform_sparse()`)
+        """
+        return _VHash.num_phrases(self)
+
+    def fit_file(
+        self,
+        /,
+        path: str,
+        labels_path: str = '',
+    ) -> VHash:
+        """Fit model on a file of documents, one per line
+
+        The file is memory-mapped, and documents are read straight from it,
+        without first being loaded into Python.
+
+        Parameters
+        ----------
+        path: str
+            newline-delimited file of documents
+        labels_path: str, optional, default=''
+            file with the class label of each document on the corresponding
+            line. If empty, documents are unlabeled (i.e. all in one class).
+            Raises :code:`ValueError` if the files have different numbers of
+            lines.
+
+        Returns
+        -------
+        VHash
+            Calling instance
+        """
+        _VHash.fit_file(self, str(path), str(labels_path))
+        return self
+
+    def transform_file(
+        self,
+        /,
+        path: str,
+        out_path: str,
+    ) -> NDArray[(Any, Any), float32]:
+        """Get numeric representation of a file of documents, one per line
+
+        Results are written straight into a memory-mapped :code:`.npy` file.
+
+        Parameters
+        ----------
+        path: str
+            newline-delimited file of documents
+        out_path: str
+            :code:`.npy` file to write results to (overwritten if it exists)
+
+        Returns
+        -------
+        numeric: NDArray([Any, Any], float32)
+            Numeric representation of documents, memory-mapped (read-only)
+            from :code:`out_path`. :code:`rep[x]` is for line :code:`x` of
+            :code:`path`.
+        """
+        _VHash.transform_file(self, str(path), str(out_path))
+        return load(out_path, mmap_mode='r')
+
+    def memory_usage(self, /) -> dict[str, int]:
+        """Memory used by each component of the model
+
+        Sizes come from actual capacities. For a model from :code:`load()`,
+        arrays are views of the memory-mapped file, so their memory is
+        file-backed pages (shared between processes), rather than heap.
+
+        Returns
+        -------
+        dict[str, int]
+            bytes used by :code:`vocabulary_keys` (phrases in the table),
+            :code:`vocabulary_index` (the table's perfect hash function),
+            :code:`word_keys` and :code:`word_index` (the same, for words,
+            if interning words), :code:`weights`, :code:`feature_indices`,
+            :code:`feature_values`, :code:`fitting` (counts kept between
+            :code:`partial_fit()` calls), and their :code:`total`
+        """
+        return _VHash.memory_usage(self)
+
+    def stats(self, /) -> dict:
+        """Stats collected while fitting and transforming
+
+        Stats are only collected if the package was built with
+        :code:`VHASH_STATS=1 pip install .`; otherwise, they are always zero
+        (and :code:`stats()['enabled']` is False).
+
+        Returns
+        -------
+        dict
+            with keys:
+
+            * :code:`enabled`: whether stats are collected
+            * :code:`seconds`: time spent in each stage (:code:`tokenize`,
+              :code:`count`, :code:`merge`, :code:`prune`, :code:`lookup`,
+              :code:`vectorize`, :code:`scatter`), summed over threads
+            * :code:`counts`: numbers of documents fit and transformed,
+              phrases generated, found and out-of-vocabulary, and prunes
+              performed (and phrases they removed)
+            * :code:`latency_histogram`: per-document transform latencies.
+              Item 0 counts latencies under 1us, and item :code:`b` counts
+              those in :code:`[2^(b-1), 2^b)` us.
+        """
+        return _VHash.stats(self)
+
+    def reset_stats(self, /) -> VHash:
+        """Reset stats to zero
+
+        Returns
+        -------
+        VHash
+            Calling instance
+        """
+        _VHash.reset_stats(self)
+        return self
+
+    def feature_errors(self, /) -> NDArray[(Any,), float32]:
+        """Approximation error of each feature, from capping its terms
+
+        See :code:`max_feature_terms` and :code:`feature_mass`.
+
+        Returns
+        -------
+        errors: NDArray([Any], float32)
+            L2 distance between each capped (and renormalized) feature and
+            the full feature, which bounds how far any transformed value
+            can move (0 for uncapped features)
+        """
+        return array(_VHash.feature_errors(self), dtype=float32)
+
+    def save(self, /, path: str):
+        """Save fitted model to a binary file
+
+        The file is versioned, and laid out so that :code:`load()` can use
+        the model straight from the memory-mapped file. An existing file is
+        replaced (not overwritten), so models loaded from it stay valid.
+
+        Parameters
+        ----------
+        path: str
+            file to save model to
+        """
+        _VHash.save(self, str(path))
+
+    @classmethod
+    def load(cls, path: str) -> VHash:
+        """Load model saved by :code:`save()`
+
+        The file is memory-mapped, and used in place without being parsed or
+        copied, so loading takes constant time, and processes loading the
+        same file share its pages. The file must not be modified in place
+        while the model is in use.
+
+        Parameters
+        ----------
+        path: str
+            file to load model from
+
+        Returns
+        -------
+        VHash
+            fitted model
+        """
+        model = cls()
+        _VHash.load(model, str(path))
+        return model